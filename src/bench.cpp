@@ -0,0 +1,842 @@
+
+#include "external.hpp"
+#include "util/timer.hpp"
+#include "util/logger.hpp"
+#include "world/chunk.hpp"
+#include "world/generator.hpp"
+#include "world/map.hpp"
+#include "world/world.hpp"
+#include "world/storage/region.hpp"
+#include "world/storage/cache.hpp"
+#include "world/scheduler.hpp"
+#include "util/thread/pool.hpp"
+#include "util/math/noise.hpp"
+
+/*
+ * Simple performance benchmarks, run without arguments to
+ * execute all of them, or pass the names of the selected ones
+ */
+
+struct Benchmark {
+	const char* name;
+	void (*function) ();
+};
+
+// used to keep the compiler from optimizing away the measured work
+static volatile uint64_t sink;
+
+/// generates a few columns of real terrain, used as input by other benchmarks
+static std::vector<Chunk*> generateSamples(int radius, int low, int high) {
+	WorldGenerator generator {8888};
+	std::vector<Chunk*> chunks;
+
+	for (int x = -radius; x <= radius; x ++) {
+		for (int z = -radius; z <= radius; z ++) {
+			for (int y = low; y <= high; y ++) {
+				chunks.push_back(generator.get({x, y, z}));
+			}
+		}
+	}
+
+	return chunks;
+}
+
+static void benchChunkPalette() {
+
+	constexpr int volume = Chunk::size * Chunk::size * Chunk::size;
+	constexpr int passes = 8;
+
+	std::vector<Chunk*> chunks = generateSamples(2, -3, 3);
+	std::vector<Block*> raw;
+
+	size_t palette_bytes = 0;
+	size_t raw_bytes = 0;
+
+	// recreate the old flat layout, allocated only for non-empty chunks
+	for (Chunk* chunk : chunks) {
+		Block* blocks = nullptr;
+
+		if (!chunk->empty()) {
+			blocks = (Block*) std::calloc(volume, sizeof(Block));
+			raw_bytes += volume * sizeof(Block);
+
+			for (int z = 0; z < Chunk::size; z ++) {
+				for (int y = 0; y < Chunk::size; y ++) {
+					for (int x = 0; x < Chunk::size; x ++) {
+						blocks[x + y * Chunk::size + z * Chunk::size * Chunk::size] = chunk->getBlock(x, y, z);
+					}
+				}
+			}
+		}
+
+		palette_bytes += chunk->bytes();
+		raw.push_back(blocks);
+	}
+
+	double palette_time = Timer::of([&] () {
+		uint64_t sum = 0;
+
+		for (int pass = 0; pass < passes; pass ++) {
+			for (Chunk* chunk : chunks) {
+				for (int z = 0; z < Chunk::size; z ++) {
+					for (int y = 0; y < Chunk::size; y ++) {
+						for (int x = 0; x < Chunk::size; x ++) {
+							sum += chunk->getBlock(x, y, z).block_type;
+						}
+					}
+				}
+			}
+		}
+
+		sink = sum;
+	}).milliseconds();
+
+	double raw_time = Timer::of([&] () {
+		uint64_t sum = 0;
+
+		for (int pass = 0; pass < passes; pass ++) {
+			for (Block* blocks : raw) {
+				for (int z = 0; z < Chunk::size; z ++) {
+					for (int y = 0; y < Chunk::size; y ++) {
+						for (int x = 0; x < Chunk::size; x ++) {
+							sum += blocks ? blocks[x + y * Chunk::size + z * Chunk::size * Chunk::size].block_type : 0;
+						}
+					}
+				}
+			}
+		}
+
+		sink = sum;
+	}).milliseconds();
+
+	double reads = (double) passes * chunks.size() * volume;
+
+	logger::info("Sampled ", chunks.size(), " chunks");
+	logger::info("Flat layout:    ", raw_bytes / chunks.size(), " bytes/chunk, ", reads / raw_time / 1000, " M reads/s");
+	logger::info("Palette layout: ", palette_bytes / chunks.size(), " bytes/chunk, ", reads / palette_time / 1000, " M reads/s");
+
+	for (Block* blocks : raw) {
+		std::free(blocks);
+	}
+
+	for (Chunk* chunk : chunks) {
+		delete chunk;
+	}
+
+}
+
+static void benchColumnMap() {
+
+	constexpr int radius = 20;
+	constexpr int vertical = 10;
+	constexpr int lookups = 1'000'000;
+
+	ColumnMap sharded;
+
+	// the previous design, a single map behind a single mutex
+	std::mutex mutex;
+	ankerl::unordered_dense::map<glm::ivec2, ChunkColumn> global;
+
+	for (int x = -radius; x <= radius; x ++) {
+		for (int z = -radius; z <= radius; z ++) {
+			for (int y = -vertical; y <= vertical; y ++) {
+				sharded.emplace(new Chunk {{x, y, z}});
+				global[glm::ivec2 {x, z}].emplace(new Chunk {{x, y, z}});
+			}
+		}
+	}
+
+	// runs the lookup function on the given number of threads, returns lookups per second
+	auto measure = [&] (int threads, auto lookup) -> double {
+		std::vector<std::thread> workers;
+
+		double time = Timer::of([&] () {
+			for (int i = 0; i < threads; i ++) {
+				workers.emplace_back([&, i] () {
+					std::mt19937 random (i);
+					uint64_t found = 0;
+
+					for (int j = 0; j < lookups; j ++) {
+						glm::ivec3 pos {(int) (random() % (2 * radius)) - radius, (int) (random() % (2 * vertical)) - vertical, (int) (random() % (2 * radius)) - radius};
+						found += lookup(pos);
+					}
+
+					sink = found;
+				});
+			}
+
+			for (std::thread& worker : workers) {
+				worker.join();
+			}
+		}).milliseconds();
+
+		return threads * (double) lookups / time * 1000;
+	};
+
+	for (int threads = 1; threads <= 16; threads *= 2) {
+		double locked = measure(threads, [&] (glm::ivec3 pos) -> bool {
+			std::lock_guard lock {mutex};
+			auto it = global.find(glm::ivec2 {pos.x, pos.z});
+
+			return it != global.end() && !it->second.get(pos.y).expired();
+		});
+
+		double striped = measure(threads, [&] (glm::ivec3 pos) -> bool {
+			return !sharded.get(pos).expired();
+		});
+
+		logger::info("Threads: ", threads, ", global mutex: ", (int) (locked / 1000), "K lookups/s, sharded: ", (int) (striped / 1000), "K lookups/s");
+	}
+
+}
+
+static void benchWorldFill() {
+
+	constexpr int extent = 100;
+
+	World world;
+	glm::ivec3 from {-extent / 2};
+	glm::ivec3 to = from + (extent - 1);
+
+	for (int cz = from.z >> Chunk::bits; cz <= (to.z >> Chunk::bits); cz ++) {
+		for (int cy = from.y >> Chunk::bits; cy <= (to.y >> Chunk::bits); cy ++) {
+			for (int cx = from.x >> Chunk::bits; cx <= (to.x >> Chunk::bits); cx ++) {
+				world.emplace(new Chunk {{cx, cy, cz}});
+			}
+		}
+	}
+
+	double single = Timer::of([&] () {
+		for (int z = from.z; z <= to.z; z ++) {
+			for (int y = from.y; y <= to.y; y ++) {
+				for (int x = from.x; x <= to.x; x ++) {
+					world.setBlock(x, y, z, Block {1});
+				}
+			}
+		}
+	}).milliseconds();
+
+	std::vector<BlockEdit> edits;
+	edits.reserve(extent * extent * extent);
+
+	for (int z = from.z; z <= to.z; z ++) {
+		for (int y = from.y; y <= to.y; y ++) {
+			for (int x = from.x; x <= to.x; x ++) {
+				edits.push_back({{x, y, z}, Block {2}});
+			}
+		}
+	}
+
+	double batch = Timer::of([&] () {
+		world.apply(edits);
+	}).milliseconds();
+
+	double box = Timer::of([&] () {
+		world.fill(from, to, Block {3});
+	}).milliseconds();
+
+	logger::info("Filling ", extent * extent * extent, " blocks");
+	logger::info("World::setBlock loop: ", single, "ms");
+	logger::info("World::apply:         ", batch, "ms");
+	logger::info("World::fill:          ", box, "ms");
+
+}
+
+/// the original raycast, going through World::getBlock for every step
+static Raycast legacyRaycast(World& world, glm::vec3 from, glm::vec3 direction, float distance) {
+
+	const float magnitude = distance * distance;
+	glm::vec3 diff = direction * distance;
+	glm::ivec3 sign = glm::sign(diff);
+	glm::ivec3 pos = glm::round(from);
+	glm::vec3 inv = glm::abs(1.0f / diff);
+
+	glm::vec3 max {
+		inv.x * (sign.x > 0 ? (pos.x + (0.5f - from.x)) : (from.x - (pos.x - 0.5f))),
+		inv.y * (sign.y > 0 ? (pos.y + (0.5f - from.y)) : (from.y - (pos.y - 0.5f))),
+		inv.z * (sign.z > 0 ? (pos.z + (0.5f - from.z)) : (from.z - (pos.z - 0.5f)))
+	};
+
+	try {
+		if (!world.getBlock(pos.x, pos.y, pos.z).isAir()) {
+			return {pos, pos};
+		}
+
+		while (glm::length2(from - glm::vec3(pos)) <= magnitude) {
+			glm::ivec3 last = pos;
+
+			if (max.x < max.y) {
+				if (max.x < max.z) {
+					pos.x += sign.x;
+					max.x += inv.x;
+				} else {
+					pos.z += sign.z;
+					max.z += inv.z;
+				}
+			} else {
+				if (max.y < max.z) {
+					pos.y += sign.y;
+					max.y += inv.y;
+				} else {
+					pos.z += sign.z;
+					max.z += inv.z;
+				}
+			}
+
+			if (!world.getBlock(pos.x, pos.y, pos.z).isAir()) {
+				return {pos, last};
+			}
+		}
+
+		return {};
+	} catch (AccessError& error) {
+		return {};
+	}
+}
+
+/// generates a set of random rays starting within the given radius of the world origin
+static std::vector<Ray> generateRays(int count, float radius, float distance) {
+	std::mt19937 random {4242};
+	std::uniform_real_distribution<float> offset {-radius, radius};
+	std::normal_distribution<float> normal {0, 1};
+	std::vector<Ray> rays;
+
+	for (int i = 0; i < count; i ++) {
+		glm::vec3 from {offset(random), offset(random), offset(random)};
+		glm::vec3 direction {normal(random), normal(random), normal(random)};
+
+		rays.push_back({from, glm::normalize(direction), distance});
+	}
+
+	return rays;
+}
+
+static void benchRaycast() {
+
+	constexpr int count = 100'000;
+	constexpr float distance = 100;
+
+	World world;
+	TaskPool pool;
+
+	for (Chunk* chunk : generateSamples(4, -3, 3)) {
+		world.emplace(chunk);
+	}
+
+	std::vector<Ray> rays = generateRays(count, 64, distance);
+	int legacy_hits = 0;
+	int skipping_hits = 0;
+	int batch_hits = 0;
+
+	double legacy = Timer::of([&] () {
+		for (const Ray& ray : rays) {
+			legacy_hits += (bool) legacyRaycast(world, ray.from, ray.direction, ray.distance);
+		}
+	}).milliseconds();
+
+	double skipping = Timer::of([&] () {
+		for (const Ray& ray : rays) {
+			skipping_hits += (bool) world.raycast(ray.from, ray.direction, ray.distance);
+		}
+	}).milliseconds();
+
+	double batch = Timer::of([&] () {
+		for (const Raycast& result : world.raycastMany(pool, rays)) {
+			batch_hits += (bool) result;
+		}
+	}).milliseconds();
+
+	// the legacy version measures distance differently and treats unloaded chunks
+	// as a miss, so the hit counts are close but not expected to be identical
+	logger::info("Casting ", count, " rays of length ", distance);
+	logger::info("World::getBlock per step: ", (int) (count / legacy * 1000), " rays/s, ", legacy_hits, " hits");
+	logger::info("World::raycast:           ", (int) (count / skipping * 1000), " rays/s, ", skipping_hits, " hits");
+	logger::info("World::raycastMany:       ", (int) (count / batch * 1000), " rays/s, ", batch_hits, " hits");
+
+}
+
+static void benchRegionStore() {
+
+	constexpr int radius = 3;
+
+	std::filesystem::path directory = std::filesystem::temp_directory_path() / "vlt3d-bench-region";
+	std::filesystem::remove_all(directory);
+
+	std::vector<Chunk*> chunks;
+	size_t count = 0;
+
+	double generate = Timer::of([&] () {
+		chunks = generateSamples(radius, -3, 3);
+	}).milliseconds();
+
+	count = chunks.size();
+
+	double save = Timer::of([&] () {
+		RegionStore store {directory};
+
+		for (Chunk* chunk : chunks) {
+			store.save(std::shared_ptr<Chunk> {chunk});
+		}
+
+		store.flush();
+	}).milliseconds();
+
+	size_t bytes = 0;
+
+	for (const auto& entry : std::filesystem::directory_iterator(directory)) {
+		bytes += entry.file_size();
+	}
+
+	RegionStore store {directory};
+
+	double load = Timer::of([&] () {
+		for (int x = -radius; x <= radius; x ++) {
+			for (int z = -radius; z <= radius; z ++) {
+				for (int y = -3; y <= 3; y ++) {
+					delete store.load({x, y, z});
+				}
+			}
+		}
+	}).milliseconds();
+
+	logger::info("Stored ", count, " chunks in ", bytes / 1024, " KiB of region files");
+	logger::info("WorldGenerator::get: ", generate / count, "ms/chunk");
+	logger::info("RegionStore::save:   ", save / count, "ms/chunk");
+	logger::info("RegionStore::load:   ", load / count, "ms/chunk");
+
+	std::filesystem::remove_all(directory);
+
+}
+
+static void benchChunkCache() {
+
+	constexpr int radius = 3;
+	constexpr int passes = 4;
+
+	WorldGenerator generator {8888};
+	ChunkCache cache {16 * 1024 * 1024};
+
+	std::vector<glm::ivec3> positions;
+	size_t raw_bytes = 0;
+
+	for (int x = -radius; x <= radius; x ++) {
+		for (int z = -radius; z <= radius; z ++) {
+			for (int y = -3; y <= 3; y ++) {
+				positions.emplace_back(x, y, z);
+			}
+		}
+	}
+
+	double generate = Timer::of([&] () {
+		for (glm::ivec3 pos : positions) {
+			Chunk* chunk = generator.get(pos);
+			raw_bytes += sizeof(Chunk) + chunk->bytes();
+			cache.put(std::shared_ptr<Chunk> {chunk});
+		}
+	}).milliseconds();
+
+	// give the background thread a moment to compress everything
+	std::this_thread::sleep_for(std::chrono::milliseconds(500));
+	size_t cached_bytes = cache.bytes();
+
+	double restore = 0;
+
+	// simulates moving back and forth over the unload boundary
+	for (int pass = 0; pass < passes; pass ++) {
+		std::vector<Chunk*> chunks;
+
+		restore += Timer::of([&] () {
+			for (glm::ivec3 pos : positions) {
+				chunks.push_back(cache.take(pos));
+			}
+		}).milliseconds();
+
+		for (Chunk* chunk : chunks) {
+			cache.put(std::shared_ptr<Chunk> {chunk});
+		}
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(500));
+	}
+
+	size_t count = positions.size();
+
+	logger::info("Cached ", count, " chunks, ", raw_bytes / 1024, " KiB loaded, ", cached_bytes / 1024, " KiB compressed");
+	logger::info("WorldGenerator::get:         ", generate / count, "ms/chunk");
+	logger::info("ChunkCache::take:            ", restore / (passes * count), "ms/chunk");
+	logger::info("Hits: ", cache.hits(), ", misses: ", cache.misses());
+
+}
+
+static void benchLoadScheduler() {
+
+	constexpr float radius = 20;
+	constexpr int vertical = 10;
+	constexpr int frames = 1000;
+
+	std::mutex mutex;
+	ankerl::unordered_dense::set<glm::ivec3> loaded;
+
+	LoadScheduler scheduler {4, 16};
+
+	const auto contains = [&] (glm::ivec3 pos) {
+		std::lock_guard lock {mutex};
+		return loaded.contains(pos);
+	};
+
+	const auto load = [&] (glm::ivec3 pos) {
+		std::lock_guard lock {mutex};
+		loaded.insert(pos);
+	};
+
+	double initial = Timer::of([&] () {
+		scheduler.update({0, 0, 0}, {0, 0, 1}, radius, vertical, contains, load);
+	}).milliseconds();
+
+	size_t frontier = scheduler.pending();
+
+	// the camera stays in the same chunk, so only the dispatching is left
+	double still = Timer::of([&] () {
+		for (int i = 0; i < frames; i ++) {
+			scheduler.update({0, 0, 0}, {0, 0, 1}, radius, vertical, contains, load);
+		}
+	}).milliseconds();
+
+	// the camera enters a new chunk every frame
+	double moving = Timer::of([&] () {
+		for (int i = 0; i < frames; i ++) {
+			scheduler.update({i, 0, 0}, {1, 0, 0}, radius, vertical, contains, load);
+		}
+	}).milliseconds();
+
+	scheduler.cancel();
+
+	logger::info("Initial frontier of ", frontier, " chunks built in ", initial, "ms");
+	logger::info("Update within the same chunk:    ", still / frames, "ms/frame");
+	logger::info("Update entering a new chunk:    ", moving / frames, "ms/frame");
+
+}
+
+static void benchBatchNoise() {
+
+	constexpr int count = 32 * 32 * 32;
+	constexpr int repeats = 20;
+
+	siv::PerlinNoise noise {8888};
+	BatchNoise batch {noise};
+
+	// the block coordinates of one chunk, the same inputs the generator uses for its 3D noise
+	std::vector<double> x(count), y(count), z(count), out(count);
+
+	for (int i = 0; i < count; i ++) {
+		x[i] = (i % 32) / 16.0;
+		y[i] = (i / 32 % 32) / 16.0;
+		z[i] = (i / 1024) / 16.0;
+	}
+
+	const auto measure = [&] (const auto& function) {
+		double time = Timer::of([&] () {
+			for (int i = 0; i < repeats; i ++) {
+				function();
+			}
+		}).milliseconds();
+
+		sink = out[count / 2] * 1000;
+		return (int) (count * repeats / time);
+	};
+
+	logger::info("siv::PerlinNoise octave3D_01: ", measure([&] () {
+		for (int i = 0; i < count; i ++) {
+			out[i] = noise.octave3D_01(x[i], y[i], z[i], 3);
+		}
+	}), "K samples/s");
+
+	for (BatchNoise::Path path : {BatchNoise::Path::SCALAR, BatchNoise::Path::SSE4, BatchNoise::Path::AVX2}) {
+		batch.setPath(path);
+
+		// a CPU without the instruction set falls back to a slower path, which has then already been measured
+		if (batch.getPath() != path) {
+			continue;
+		}
+
+		logger::info("BatchNoise octave3D_01 (path ", (int) path, "): ", measure([&] () {
+			batch.octave3D_01(x, y, z, out, 3);
+		}), "K samples/s");
+	}
+
+}
+
+static void benchWorldGenerator() {
+
+	constexpr int radius = 3;
+	constexpr int vertical = 10;
+
+	// in the order the load scheduler would request them, closest first, so the chunks of one column are spread out
+	std::vector<glm::ivec3> positions;
+
+	for (int x = -radius; x <= radius; x ++) {
+		for (int z = -radius; z <= radius; z ++) {
+			for (int y = -vertical; y <= vertical; y ++) {
+				positions.emplace_back(x, y, z);
+			}
+		}
+	}
+
+	std::sort(positions.begin(), positions.end(), [] (glm::ivec3 a, glm::ivec3 b) {
+		return glm::length2(glm::vec3(a)) < glm::length2(glm::vec3(b));
+	});
+
+	// the terrain never reaches above y=64, so these chunks only ever need the 2D noise
+	std::vector<glm::ivec3> above;
+
+	std::copy_if(positions.begin(), positions.end(), std::back_inserter(above), [] (glm::ivec3 pos) {
+		return pos.y >= 2;
+	});
+
+	// and these are always fully below it, they only differ from solid stone by the caves
+	std::vector<glm::ivec3> below;
+
+	std::copy_if(positions.begin(), positions.end(), std::back_inserter(below), [] (glm::ivec3 pos) {
+		return pos.y <= -2;
+	});
+
+	const auto generate = [&] (const std::vector<glm::ivec3>& positions, size_t capacity) {
+		WorldGenerator generator {8888, capacity};
+		size_t blocks = 0;
+
+		double time = Timer::of([&] () {
+			for (glm::ivec3 pos : positions) {
+				Chunk* chunk = generator.terrain(pos);
+				blocks += chunk->count();
+				delete chunk;
+			}
+		}).milliseconds();
+
+		sink = blocks;
+		return positions.size() / time * 1000;
+	};
+
+	logger::info("Generating ", positions.size(), " chunks in ", (2 * radius + 1) * (2 * radius + 1), " columns, ", above.size(), " of them above the terrain, ", below.size(), " below it");
+	logger::info("Without column cache: ", (int) generate(positions, 0), " chunks/s, above the terrain: ", (int) generate(above, 0), " chunks/s, below the terrain: ", (int) generate(below, 0), " chunks/s");
+	logger::info("With column cache:    ", (int) generate(positions, 256), " chunks/s, above the terrain: ", (int) generate(above, 256), " chunks/s, below the terrain: ", (int) generate(below, 256), " chunks/s");
+
+}
+
+static void benchTerrainDensity() {
+
+	constexpr int radius = 2;
+
+	std::vector<glm::ivec3> positions;
+
+	for (int x = -radius; x <= radius; x ++) {
+		for (int z = -radius; z <= radius; z ++) {
+			for (int y = -3; y <= 1; y ++) {
+				positions.emplace_back(x, y, z);
+			}
+		}
+	}
+
+	const auto generate = [&] (WorldGenerator::Density density, std::vector<std::unique_ptr<Chunk>>& chunks) {
+		WorldGenerator generator {8888};
+		generator.setDensity(density);
+
+		double time = Timer::of([&] () {
+			for (glm::ivec3 pos : positions) {
+				chunks.emplace_back(generator.terrain(pos));
+			}
+		}).milliseconds();
+
+		return positions.size() / time * 1000;
+	};
+
+	std::vector<std::unique_ptr<Chunk>> reference;
+	logger::info("Full density: ", (int) generate(WorldGenerator::Density::FULL, reference), " chunks/s");
+
+	for (WorldGenerator::Density density : {WorldGenerator::Density::COARSE_4, WorldGenerator::Density::COARSE_8}) {
+		std::vector<std::unique_ptr<Chunk>> chunks;
+		double speed = generate(density, chunks);
+
+		size_t solid = 0;
+		size_t expected = 0;
+		size_t different = 0;
+
+		for (size_t i = 0; i < chunks.size(); i ++) {
+			solid += chunks[i]->count();
+			expected += reference[i]->count();
+
+			for (int j = 0; j < Chunk::size * Chunk::size * Chunk::size; j ++) {
+				int x = j % Chunk::size, y = j / Chunk::size % Chunk::size, z = j / (Chunk::size * Chunk::size);
+				different += chunks[i]->getBlock(x, y, z) != reference[i]->getBlock(x, y, z);
+			}
+		}
+
+		logger::info("Density of one sample per ", (int) density, " blocks: ", (int) speed, " chunks/s, ", different * 100.0 / expected, "% of blocks differ, ", solid * 100.0 / expected, "% of the solid blocks");
+	}
+
+	// a vertical cross-section through the middle of the sampled area, '#' is solid in both modes, '+' only at full
+	// density, 'o' only in the coarse one, this makes it easy to see how the caves and overhangs got smoothed out
+	std::vector<std::unique_ptr<Chunk>> coarse;
+	generate(WorldGenerator::Density::COARSE_4, coarse);
+
+	for (int y = 47; y >= -48; y -= 2) {
+		std::string line;
+
+		for (int x = -Chunk::size; x < Chunk::size; x ++) {
+			glm::ivec3 pos {x >> Chunk::bits, y >> Chunk::bits, 0};
+			size_t index = std::find(positions.begin(), positions.end(), pos) - positions.begin();
+
+			bool full = !reference[index]->getBlock(x & Chunk::mask, y & Chunk::mask, 0).isAir();
+			bool lattice = !coarse[index]->getBlock(x & Chunk::mask, y & Chunk::mask, 0).isAir();
+
+			line += full ? (lattice ? '#' : '+') : (lattice ? 'o' : ' ');
+		}
+
+		logger::info("|", line, "|");
+	}
+
+}
+
+static void benchGenerationPipeline() {
+
+	constexpr int radius = 4;
+	constexpr int vertical = 3;
+	constexpr int threads = 8;
+
+	// closest first, like the load scheduler requests them, and from as many threads as it uses
+	std::vector<glm::ivec3> positions;
+
+	for (int x = -radius; x <= radius; x ++) {
+		for (int z = -radius; z <= radius; z ++) {
+			for (int y = -vertical; y <= vertical; y ++) {
+				positions.emplace_back(x, y, z);
+			}
+		}
+	}
+
+	std::sort(positions.begin(), positions.end(), [] (glm::ivec3 a, glm::ivec3 b) {
+		return glm::length2(glm::vec3(a)) < glm::length2(glm::vec3(b));
+	});
+
+	WorldGenerator generator {8888};
+	std::atomic<size_t> next {0};
+	std::atomic<size_t> counts[5] {};
+	std::vector<std::thread> workers;
+
+	double time = Timer::of([&] () {
+		for (int i = 0; i < threads; i ++) {
+			workers.emplace_back([&] () {
+				for (size_t index = next ++; index < positions.size(); index = next ++) {
+					std::unique_ptr<Chunk> chunk {generator.get(positions[index])};
+
+					for (int j = 0; j < Chunk::size * Chunk::size * Chunk::size; j ++) {
+						Block block = chunk->getBlock(j % Chunk::size, j / Chunk::size % Chunk::size, j / (Chunk::size * Chunk::size));
+						counts[std::min<int>(block.block_type, 4)] ++;
+					}
+				}
+			});
+		}
+
+		for (std::thread& worker : workers) {
+			worker.join();
+		}
+	}).milliseconds();
+
+	const GenerationPipeline& pipeline = generator.getPipeline();
+
+	logger::info("Generated ", positions.size(), " final chunks on ", threads, " threads: ", (int) (positions.size() / time * 1000), " chunks/s");
+	logger::info("Blocks of stone: ", counts[1].load(), ", grass: ", counts[2].load(), ", logs: ", counts[3].load(), ", leaves: ", counts[4].load());
+
+	for (auto stage : {GenerationPipeline::TERRAIN, GenerationPipeline::CARVING, GenerationPipeline::DECORATION}) {
+		size_t jobs = pipeline.getStageJobs(stage);
+		logger::info("Stage ", (int) stage, ": ", jobs, " jobs, ", pipeline.getStageTime(stage) / std::max<size_t>(jobs, 1), "ms/job");
+	}
+
+}
+
+static void benchFluidFlood() {
+
+	constexpr int radius = 3;
+	constexpr int spacing = 8;
+	constexpr int limit = 500;
+
+	World world;
+	TaskPool pool;
+
+	for (Chunk* chunk : generateSamples(radius, -1, 1)) {
+		world.emplace(chunk);
+	}
+
+	// a grid of sources placed on top of the terrain, the fluid then runs down into the valleys
+	std::vector<BlockEdit> sources;
+	const int extent = radius * Chunk::size;
+
+	for (int z = -extent; z < extent; z += spacing) {
+		for (int x = -extent; x < extent; x += spacing) {
+			std::optional<int> height = world.getHeight(x, z);
+
+			if (height && *height + 1 < 2 * Chunk::size) {
+				sources.push_back({{x, *height + 1, z}, FluidSimulator::fluid(1, FluidSimulator::source)});
+			}
+		}
+	}
+
+	world.apply(sources);
+
+	int ticks = 0;
+	size_t changes = 0;
+	size_t peak = 0;
+
+	double flood = Timer::of([&] () {
+		while (ticks < limit) {
+			size_t changed = world.tickFluids(pool);
+
+			if (changed == 0) {
+				break;
+			}
+
+			changes += changed;
+			peak = std::max(peak, changed);
+			ticks ++;
+		}
+	}).milliseconds();
+
+	// everything is settled, so these should cost next to nothing
+	double idle = Timer::of([&] () {
+		for (int i = 0; i < limit; i ++) {
+			sink = world.tickFluids(pool);
+		}
+	}).milliseconds();
+
+	logger::info("Flooding from ", sources.size(), " sources took ", ticks, " ticks, ", changes, " changed blocks, at most ", peak, " in one tick");
+	logger::info("World::tickFluids flooding: ", (int) (ticks / flood * 1000), " ticks/s, ", flood / std::max(ticks, 1), "ms/tick");
+	logger::info("World::tickFluids settled:  ", idle / limit, "ms/tick");
+
+}
+
+static const Benchmark benchmarks[] = {
+	{"chunk_palette", benchChunkPalette},
+	{"column_map", benchColumnMap},
+	{"world_fill", benchWorldFill},
+	{"raycast", benchRaycast},
+	{"region_store", benchRegionStore},
+	{"chunk_cache", benchChunkCache},
+	{"load_scheduler", benchLoadScheduler},
+	{"fluid_flood", benchFluidFlood},
+	{"batch_noise", benchBatchNoise},
+	{"world_generator", benchWorldGenerator},
+	{"terrain_density", benchTerrainDensity},
+	{"generation_pipeline", benchGenerationPipeline},
+};
+
+int main(int argc, char** argv) {
+
+	for (const Benchmark& benchmark : benchmarks) {
+		if (argc > 1 && std::find(argv + 1, argv + argc, std::string {benchmark.name}) == argv + argc) {
+			continue;
+		}
+
+		logger::info("Running benchmark '", benchmark.name, "'");
+		benchmark.function();
+	}
+
+	return 0;
+}
@@ -1,6 +1,11 @@
 
 #include "sprites.hpp"
 
+// the headless build uses the baked sprites for meshing, but has no images to bake them from
+#if !defined(VLT3D_HEADLESS)
+#	include "image.hpp"
+#endif
+
 /*
  * BakedSprite
  */
@@ -45,9 +50,11 @@ UnbakedSprite UnbakedSprite::combine(UnbakedSprite other) const {
 	return {x + other.x, y + other.y, other.w, other.h};
 }
 
+#if !defined(VLT3D_HEADLESS)
 BakedSprite UnbakedSprite::bake(const ImageData& image) const {
 	return bake(image.width(), image.height());
 }
+#endif
 
 BakedSprite UnbakedSprite::bake(int width, int height) const {
 	const int x1 = x + 0;
@@ -65,9 +72,11 @@ BakedSprite UnbakedSprite::bake(int width, int height) const {
 	};
 }
 
+#if !defined(VLT3D_HEADLESS)
 UnbakedSprite UnbakedSprite::identity(const ImageData& image) {
 	return {0, 0, (int) image.width(), (int) image.height()};
 }
+#endif
 
 /*
  * PairedSprite
@@ -84,6 +93,8 @@ BakedSprite PairedSprite::getBaked() const {
 	return baked;
 }
 
+#if !defined(VLT3D_HEADLESS)
 PairedSprite PairedSprite::identity(const ImageData& image) {
 	return {UnbakedSprite::identity(image), BakedSprite::identity()};
-}
\ No newline at end of file
+}
+#endif
\ No newline at end of file
@@ -1,7 +1,8 @@
 #pragma once
 
 #include "external.hpp"
-#include "image.hpp"
+
+class ImageData;
 
 struct BakedSprite {
 
@@ -11,8 +11,10 @@ InputResult PlayScreen::onEvent(ScreenStack& stack, InputContext& input, const I
 	if (auto key = event.as<KeyboardEvent>()) {
 
 		if (key->isKeyPressed(GLFW_KEY_R)) {
-			if (Raycast raycast = world.raycast(camera.getPosition(), {0, -1, 0}, 1000)) {
-				camera.move(raycast.getPos() + glm::ivec3 {0, 1, 0});
+			glm::ivec3 pos = glm::floor(camera.getPosition() + 0.5f);
+
+			if (std::optional<int> height = world.getHeight(pos.x, pos.z)) {
+				camera.move(glm::ivec3 {pos.x, *height + 1, pos.z});
 			}
 		}
 
@@ -29,12 +31,14 @@ void PlayScreen::draw(ImmediateRenderer& immediate, InputContext& input, Camera&
 		Block air {0};
 		Block idk {2};
 
+		BlockAccessor accessor {world};
+
 		if (input.isRightPressed()) {
 			if (Raycast raycast = world.raycast(camera.getPosition(), camera.getDirection(), 25.0f)) {
 				glm::ivec3 pos = raycast.getPos();
 
-				if (world.getBlock(pos.x, pos.y, pos.z) != air) {
-					world.setBlock(pos.x, pos.y, pos.z, air);
+				if (accessor.getBlock(pos.x, pos.y, pos.z) != air) {
+					accessor.setBlock(pos.x, pos.y, pos.z, air);
 				}
 			}
 		}
@@ -43,8 +47,8 @@ void PlayScreen::draw(ImmediateRenderer& immediate, InputContext& input, Camera&
 			if (Raycast raycast = world.raycast(camera.getPosition(), camera.getDirection(), 25.0f)) {
 				glm::ivec3 pos = raycast.getTarget();
 
-				if (world.getBlock(pos.x, pos.y, pos.z) != idk) {
-					world.setBlock(pos.x, pos.y, pos.z, idk);
+				if (accessor.getBlock(pos.x, pos.y, pos.z) != idk) {
+					accessor.setBlock(pos.x, pos.y, pos.z, idk);
 				}
 			}
 		}
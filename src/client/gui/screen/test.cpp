@@ -2,9 +2,10 @@
 #include "test.hpp"
 #include "pause.hpp"
 #include "world/render/renderer.hpp"
+#include "world/world.hpp"
 
-TestScreen::TestScreen(Profiler& profiler)
-: profiler(profiler) {}
+TestScreen::TestScreen(Profiler& profiler, World& world)
+: profiler(profiler), world(world) {}
 
 InputResult TestScreen::onEvent(ScreenStack& stack, InputContext& input, const InputEvent& event) {
 	if (auto* key = event.as<KeyboardEvent>()) {
@@ -75,6 +76,11 @@ void TestScreen::draw(ImmediateRenderer& renderer, InputContext& input, Camera&
 	int visible = world_visible_count;
 	int occluders = world_occlusion_count;
 
+	size_t loaded = world.getLoadedChunks();
+	size_t memory = world.getMemoryUsage();
+	size_t budget = world.getMemoryBudget();
+	size_t cached = world.getCache().bytes();
+
 	int width = renderer.getWidth();
 
 	glm::vec3 pos = camera.getPosition();
@@ -82,6 +88,7 @@ void TestScreen::draw(ImmediateRenderer& renderer, InputContext& input, Camera&
 	renderer.drawText(10, 10 + 18 * 1, "X: " + format(pos.x, 4) + ", Y: " + format(pos.y, 4) + ", Z: " + format(pos.z, 4));
 	renderer.drawText(10, 10 + 18 * 2, "Vertices: " + std::to_string(vertices) + ", chunks: " + std::to_string(visible) + "/" + std::to_string(chunks));
 	renderer.drawText(10, 10 + 18 * 3, "Free Identifiers: " + std::to_string(occluders));
+	renderer.drawText(10, 10 + 18 * 4, "World: " + std::to_string(memory / 1024 / 1024) + "/" + std::to_string(budget / 1024 / 1024) + " MiB, chunks: " + std::to_string(loaded) + " (avg: " + std::to_string(memory / std::max<size_t>(loaded, 1) / 1024) + " KiB), cache: " + std::to_string(cached / 1024 / 1024) + " MiB");
 
 	renderer.setAlignment(HorizontalAlignment::RIGHT);
 	renderer.drawText(width - 10, 10 + 18 * 0, test ? "Press [SPACE] to hide" : "Press [SPACE] to show");
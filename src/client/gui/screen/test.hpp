@@ -4,16 +4,19 @@
 #include "client/gui/screen.hpp"
 #include "window/profiler.hpp"
 
+class World;
+
 class TestScreen : public Screen {
 
 	private:
 
 		Profiler& profiler;
+		World& world;
 		bool test = true;
 
 	public:
 
-		TestScreen(Profiler& profiler);
+		TestScreen(Profiler& profiler, World& world);
 		~TestScreen() override = default;
 
 		InputResult onEvent(ScreenStack& stack, InputContext& input, const InputEvent& event) override;
@@ -21,6 +21,7 @@
 #include <queue>
 #include <thread>
 #include <mutex>
+#include <shared_mutex>
 #include <future>
 #include <condition_variable>
 #include <algorithm>
@@ -29,6 +30,11 @@
 #include <regex>
 #include <fstream>
 #include <ranges>
+#include <span>
+
+// The headless build (see the 'headless' target) only uses the world and the
+// mesher, and is compiled without any of the window, audio and graphics libraries
+#if !defined(VLT3D_HEADLESS)
 
 // STB
 #define STB_VORBIS_HEADER_ONLY
@@ -54,6 +60,8 @@
 #define VMA_VULKAN_VERSION 1000000
 #include "vk_mem_alloc.h"
 
+#endif
+
 // GLM
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
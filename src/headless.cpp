@@ -0,0 +1,322 @@
+
+#include "external.hpp"
+#include "util/timer.hpp"
+#include "util/logger.hpp"
+#include "world/world.hpp"
+#include "world/view.hpp"
+#include "world/generator.hpp"
+#include "world/render/mesher.hpp"
+#include "util/thread/pool.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+#	include <sys/resource.h>
+#endif
+
+/*
+ * Headless world benchmark, flies a camera along a few fixed paths through a world with a fixed seed,
+ * meshing every chunk the world asks to be meshed, just like the renderer would, but without any window or GPU.
+ * The results are printed (or written to the file given as the first argument) as JSON, so that they can be
+ * compared between builds, the counts only depend on the seed and paths, the timings on the machine.
+ */
+
+struct CameraPath {
+	const char* name;
+	int frames;
+	glm::vec3 (*position) (int frame);
+};
+
+static constexpr uint64_t seed = 8888;
+static constexpr float radius = 5;
+static constexpr int vertical = 2;
+
+// how long to wait for the loading to finish after each frame
+static constexpr double settle_limit = 60 * 1000;
+
+// the number of single block edits to measure the remesh latency with
+static constexpr int edits = 200;
+
+// the actual sprites don't matter, only that they are distinct (and not zero, that's an empty face to the reference mesher)
+static constexpr TerrainSprites sprites {1, 2, 3, 4};
+
+static const CameraPath paths[] = {
+	{"spawn", 1, [] (int frame) { return glm::vec3 {0, 48, 0}; }},
+	{"straight", 120, [] (int frame) { return glm::vec3 {frame * 4.0f, 48, 0}; }},
+	{"circle", 120, [] (int frame) { return glm::vec3 {std::cos(frame / 60.0f * (float) M_PI) * 96, 48, std::sin(frame / 60.0f * (float) M_PI) * 96}; }},
+};
+
+/// Returns the peak resident set size of this process, in bytes, or zero if it's not known on this platform
+static size_t getPeakMemory() {
+	#if defined(__unix__) || defined(__APPLE__)
+	rusage usage {};
+	getrusage(RUSAGE_SELF, &usage);
+
+	// for some reason this is in kilobytes on Linux and in bytes on macOS
+	#if defined(__APPLE__)
+	return usage.ru_maxrss;
+	#else
+	return usage.ru_maxrss * 1024;
+	#endif
+	#else
+	return 0;
+	#endif
+}
+
+/// Returns the sample below which the given fraction of the samples lie
+static double percentile(std::vector<double> samples, double fraction) {
+	if (samples.empty()) {
+		return 0;
+	}
+
+	const size_t index = std::min<size_t>(samples.size() * fraction, samples.size() - 1);
+	std::nth_element(samples.begin(), samples.begin() + index, samples.end());
+
+	return samples[index];
+}
+
+static nlohmann::ordered_json latencies(const std::vector<double>& samples) {
+	nlohmann::ordered_json json;
+	json["p50"] = percentile(samples, 0.50);
+	json["p99"] = percentile(samples, 0.99);
+	json["max"] = percentile(samples, 1.00);
+	return json;
+}
+
+/// The timings and output size of one of the mesher paths
+struct MesherStats {
+	std::vector<double> times;
+	size_t vertices = 0;
+
+	template <typename Buffer>
+	void emit(MeshEmitterSet& emitters, Buffer& buffer, WorldView& view, const TerrainSprites& sprites) {
+		auto planes = std::make_unique<ChunkPlaneMesh>();
+
+		times.push_back(Timer::of([&] () {
+			GreedyMesher::emitChunk(emitters, buffer, view, sprites, *planes);
+		}).milliseconds());
+
+		// only the full detail meshes, one per direction
+		for (int direction = 0; direction < 6; direction ++) {
+			vertices += emitters.get(direction).size();
+		}
+	}
+
+	nlohmann::ordered_json toJson(size_t meshed) const {
+		const double total = std::reduce(times.begin(), times.end(), 0.0);
+
+		nlohmann::ordered_json json;
+		json["chunks_per_second"] = meshed / std::max(total / 1000, 1e-9);
+		json["vertices_per_chunk"] = vertices / (double) std::max<size_t>(meshed, 1);
+		json["quads_per_chunk"] = vertices / 6.0 / std::max<size_t>(meshed, 1);
+		json["latency_ms"] = latencies(times);
+		return json;
+	}
+};
+
+static nlohmann::ordered_json runPath(const CameraPath& path) {
+
+	WorldGenerator generator {seed};
+	World world;
+
+	MeshEmitterSet emitters {1024};
+	ChunkMaskBuffer mask_buffer;
+	ChunkFaceBuffer face_buffer;
+
+	// every chunk is meshed with both the binary path (used by the game) and the reference one
+	MesherStats binary;
+	MesherStats reference;
+
+	std::vector<double> update_times;
+	ankerl::unordered_dense::set<glm::ivec3> centers;
+	size_t meshed = 0;
+	size_t skipped = 0;
+
+	const auto mesh = [&] (WorldView&& view, bool important, bool restored) {
+		view.capture();
+
+		// the same check the render pool does, these chunks have no faces
+		if (view.getOriginChunk()->empty() || view.enclosed()) {
+			skipped ++;
+			return;
+		}
+
+		binary.emit(emitters, mask_buffer, view, sprites);
+		reference.emit(emitters, face_buffer, view, sprites);
+		meshed ++;
+	};
+
+	LoadScheduler& scheduler = world.getScheduler();
+
+	// the camera only moves on once the world around it is fully loaded and meshed, this way
+	// the counts only depend on the seed and the path, and not on the speed of the machine
+	const auto frame = [&] (glm::vec3 position, glm::vec3 facing) {
+		glm::ivec3 origin = glm::floor(position);
+		Timer timer;
+
+		centers.insert(origin >> Chunk::bits);
+
+		update_times.push_back(Timer::of([&] () {
+			world.update(generator, origin, facing, radius, vertical);
+		}).milliseconds());
+
+		while (true) {
+			world.consumeUpdates(mesh);
+
+			if (scheduler.pending() == 0 && scheduler.active() == 0) {
+				world.consumeUpdates(mesh);
+				return;
+			}
+
+			if (timer.milliseconds() > settle_limit) {
+				logger::error("Loading didn't finish in time, the results will not be comparable!");
+				return;
+			}
+
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			world.update(generator, origin, facing, radius, vertical);
+		}
+	};
+
+	Timer timer;
+
+	for (int i = 0; i < path.frames; i ++) {
+		glm::vec3 position = path.position(i);
+		glm::vec3 facing = path.position(i + 1) - position;
+
+		frame(position, glm::length(facing) > 0 ? glm::normalize(facing) : glm::vec3 {0, 0, 1});
+	}
+
+	const double seconds = timer.milliseconds() / 1000;
+	const GenerationPipeline& pipeline = generator.getPipeline();
+	const size_t generated = pipeline.getStageJobs(GenerationPipeline::DECORATION);
+
+	nlohmann::ordered_json json;
+	json["name"] = path.name;
+	json["frames"] = path.frames;
+	json["seconds"] = seconds;
+	json["center_chunks"] = centers.size();
+	json["loaded_chunks"] = world.getLoadedChunks();
+
+	json["generation"]["chunks"] = generated;
+	json["generation"]["chunks_per_second"] = generated / seconds;
+
+	const char* stages[] = {"terrain", "carving", "decoration"};
+
+	for (auto stage : {GenerationPipeline::TERRAIN, GenerationPipeline::CARVING, GenerationPipeline::DECORATION}) {
+		const size_t jobs = pipeline.getStageJobs(stage);
+
+		json["generation"]["stages"][stages[stage]]["jobs"] = jobs;
+		json["generation"]["stages"][stages[stage]]["ms_per_job"] = pipeline.getStageTime(stage) / std::max<size_t>(jobs, 1);
+	}
+
+	json["meshing"]["chunks"] = meshed;
+	json["meshing"]["skipped"] = skipped;
+	json["meshing"]["binary"] = binary.toJson(meshed);
+	json["meshing"]["reference"] = reference.toJson(meshed);
+
+	// only the first update of each frame, the ones that follow while waiting for the loading have nothing to do
+	json["update"]["latency_ms"] = latencies(update_times);
+
+	// this is the peak of the whole process so far, so it never goes down between the paths
+	json["peak_rss_kib"] = getPeakMemory() / 1024;
+
+	return json;
+}
+
+/// Measures the edit-to-mesh latency of a single surface chunk, with the planes meshed on one thread and in parallel
+static nlohmann::ordered_json runEdits() {
+
+	WorldGenerator generator {seed};
+	World world;
+
+	const glm::ivec3 origin {0, 0, 0};
+
+	for (glm::ivec3 offset : {glm::ivec3 {0, 0, 0}, {-1, 0, 0}, {1, 0, 0}, {0, -1, 0}, {0, 1, 0}, {0, 0, -1}, {0, 0, 1}}) {
+		world.emplace(generator.get(origin + offset));
+	}
+
+	std::shared_ptr<Chunk> chunk = world.getChunk(origin.x, origin.y, origin.z).lock();
+	std::mt19937 random {seed};
+
+	TaskPool pool {2};
+	MeshEmitterSet emitters {1024};
+	ChunkMaskBuffer buffer;
+
+	const auto capture = [&] () {
+		WorldView view = world.getView(origin, Direction::ALL);
+		view.capture();
+		return view;
+	};
+
+	// the same chunk is kept meshed by both, so that both only remesh the planes changed by each edit
+	auto serial_planes = std::make_unique<ChunkPlaneMesh>();
+	auto parallel_planes = std::make_unique<ChunkPlaneMesh>();
+
+	std::vector<double> serial_edits, parallel_edits;
+	std::vector<double> serial_full, parallel_full;
+
+	for (int i = 0; i < edits; i ++) {
+		const int x = random() % Chunk::size;
+		const int y = random() % Chunk::size;
+		const int z = random() % Chunk::size;
+
+		chunk->setBlock(x, y, z, chunk->getBlock(x, y, z).isAir() ? Block {1} : Block {0});
+		WorldView view = capture();
+
+		serial_edits.push_back(Timer::of([&] () {
+			GreedyMesher::emitChunk(emitters, buffer, view, sprites, *serial_planes);
+		}).milliseconds());
+
+		parallel_edits.push_back(Timer::of([&] () {
+			GreedyMesher::emitChunk(emitters, buffer, view, sprites, *parallel_planes, &pool);
+		}).milliseconds());
+
+		// and the whole chunk, as after a load or when the mesh is no longer cached
+		auto serial_empty = std::make_unique<ChunkPlaneMesh>();
+		auto parallel_empty = std::make_unique<ChunkPlaneMesh>();
+
+		serial_full.push_back(Timer::of([&] () {
+			GreedyMesher::emitChunk(emitters, buffer, view, sprites, *serial_empty);
+		}).milliseconds());
+
+		parallel_full.push_back(Timer::of([&] () {
+			GreedyMesher::emitChunk(emitters, buffer, view, sprites, *parallel_empty, &pool);
+		}).milliseconds());
+	}
+
+	nlohmann::ordered_json json;
+	json["edits"] = edits;
+	json["edit"]["serial_latency_ms"] = latencies(serial_edits);
+	json["edit"]["parallel_latency_ms"] = latencies(parallel_edits);
+	json["full"]["serial_latency_ms"] = latencies(serial_full);
+	json["full"]["parallel_latency_ms"] = latencies(parallel_full);
+
+	return json;
+}
+
+int main(int argc, char** argv) {
+
+	// keep the output clean, only the errors go in between the results
+	LoggerLock lock {Logger::ERROR | Logger::FATAL};
+
+	nlohmann::ordered_json json;
+	json["seed"] = seed;
+	json["radius"] = radius;
+	json["vertical"] = vertical;
+	json["paths"] = nlohmann::ordered_json::array();
+
+	for (const CameraPath& path : paths) {
+		json["paths"].push_back(runPath(path));
+	}
+
+	json["remesh"] = runEdits();
+	json["peak_rss_kib"] = getPeakMemory() / 1024;
+
+	if (argc > 1) {
+		std::ofstream file {argv[1]};
+		file << json.dump(4) << std::endl;
+	} else {
+		std::cout << json.dump(4) << std::endl;
+	}
+
+	return 0;
+}
@@ -34,9 +34,13 @@ int main() {
 	// for now
 	Swapchain& swapchain = system.swapchain;
 
-	World world;
-	WorldRenderer world_renderer {system, world};
+	// the generator needs to outlive the world, as it's used by the world's loading tasks
 	WorldGenerator world_generator {8888};
+	World world {"saves/world"};
+	WorldRenderer world_renderer {system, world};
+
+	// runs the parallel parts of the world tick
+	TaskPool tick_pool;
 
 	ScreenStack stack;
 	ImmediateRenderer immediate {system.assets};
@@ -45,7 +49,7 @@ int main() {
 	window.setRootInputConsumer(&stack);
 
 	Profiler profiler;
-	stack.open(new GroupScreen {new PlayScreen {world, camera}, new TestScreen {profiler}});
+	stack.open(new GroupScreen {new PlayScreen {world, camera}, new TestScreen {profiler, world}});
 
 	while (!window.shouldClose()) {
 		window.poll();
@@ -107,7 +111,8 @@ int main() {
 		// so we would need some internal subpass dependency stuff that i know nothing about
 		recorder.bufferTransferBarrier(VK_PIPELINE_STAGE_VERTEX_INPUT_BIT);
 
-		world.update(world_generator, camera.getPosition(), 20, 10);
+		world.update(world_generator, camera.getPosition(), camera.getDirection(), 20, 10);
+		world.advance(tick_pool);
 		world_renderer.draw(recorder, frustum, camera);
 		world_renderer.eraseOutside(camera.getPosition(), 24);
 
@@ -157,6 +162,7 @@ int main() {
 		sound_system.update();
 	}
 
+	world.save();
 	world_renderer.close();
 	system.close();
 	window.close();
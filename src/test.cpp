@@ -1,6 +1,8 @@
 
 #include <vstl.hpp>
 #include "util/math/bits.hpp"
+#include "util/math/noise.hpp"
+#include "util/math/random.hpp"
 #include "util/collection/pyramid.hpp"
 #include "util/exception.hpp"
 #include "buffer/array.hpp"
@@ -8,6 +10,15 @@
 #include "util/collection/ring.hpp"
 #include "util/util.hpp"
 #include "util/thread/delegator.hpp"
+#include "world/chunk.hpp"
+#include "world/storage/codec.hpp"
+#include "world/storage/region.hpp"
+#include "world/storage/cache.hpp"
+#include "world/scheduler.hpp"
+#include "world/world.hpp"
+#include "world/generator.hpp"
+#include "world/view.hpp"
+#include "world/render/mesher.hpp"
 
 BEGIN(VSTL_MODE_LENIENT)
 
@@ -630,4 +641,1357 @@ TEST(util_arena) {
 	// say no to memory leaks
 	arena.free(b256);
 	arena.close();
-};
\ No newline at end of file
+};
+
+TEST(util_batch_noise) {
+
+	siv::PerlinNoise noise {1234};
+	BatchNoise batch {noise};
+	Random random {42};
+
+	// an odd count, so that every path also has to finish with the scalar remainder
+	constexpr int count = 1003;
+	std::vector<double> x(count), y(count), z(count), out(count);
+
+	for (int i = 0; i < count; i ++) {
+		x[i] = random.uniformFloat(-300, 300);
+		y[i] = random.uniformFloat(-300, 300);
+		z[i] = random.uniformFloat(-300, 300);
+	}
+
+	// the paths are expected to match exactly, the tolerance only allows for the compiler contracting the scalar siv code
+	const auto compare = [&] (const auto& expected) {
+		for (int i = 0; i < count; i ++) {
+			if (std::abs(out[i] - expected(i)) > 1e-12) {
+				FAIL("Batch noise differs from siv::PerlinNoise");
+			}
+		}
+	};
+
+	for (BatchNoise::Path path : {BatchNoise::Path::SCALAR, BatchNoise::Path::SSE4, BatchNoise::Path::AVX2}) {
+		batch.setPath(path);
+
+		batch.noise3D(x, y, z, out);
+		compare([&] (int i) { return noise.noise3D(x[i], y[i], z[i]); });
+
+		batch.noise3D_01(x, y, z, out);
+		compare([&] (int i) { return noise.noise3D_01(x[i], y[i], z[i]); });
+
+		batch.octave2D_01(x, y, out, 2);
+		compare([&] (int i) { return noise.octave2D_01(x[i], y[i], 2); });
+
+		batch.octave3D_01(x, y, z, out, 3);
+		compare([&] (int i) { return noise.octave3D_01(x[i], y[i], z[i], 3); });
+
+		batch.octave3D_01(x, y, z, out, 5, 0.7);
+		compare([&] (int i) { return noise.octave3D_01(x[i], y[i], z[i], 5, 0.7); });
+	}
+
+};
+
+TEST(world_chunk_palette) {
+
+	Chunk chunk {{0, 0, 0}};
+	std::vector<Block::packed_type> blocks(Chunk::size * Chunk::size * Chunk::size, 0);
+	std::mt19937 random {42};
+
+	CHECK(chunk.empty(), true);
+
+	// every width step is visited as the number of distinct blocks grows
+	for (int types : {1, 2, 3, 4, 5, 16, 17, 300}) {
+		for (int i = 0; i < 20000; i ++) {
+			int x = random() % Chunk::size;
+			int y = random() % Chunk::size;
+			int z = random() % Chunk::size;
+			Block::packed_type value = random() % types;
+
+			chunk.setBlock(x, y, z, Block {value});
+			blocks[x + y * Chunk::size + z * Chunk::size * Chunk::size] = value;
+		}
+
+		for (int z = 0; z < Chunk::size; z ++) {
+			for (int y = 0; y < Chunk::size; y ++) {
+				for (int x = 0; x < Chunk::size; x ++) {
+					if (chunk.getBlock(x, y, z).packed() != blocks[x + y * Chunk::size + z * Chunk::size * Chunk::size]) {
+						FAIL("Chunk palette storage returned incorrect block");
+					}
+				}
+			}
+		}
+	}
+
+	CHECK(chunk.empty(), false);
+
+};
+
+TEST(world_chunk_uniform) {
+
+	Chunk chunk {{0, 0, 0}};
+
+	chunk.fill(Block {1});
+	CHECK(chunk.uniform(), true);
+	CHECK(chunk.solid(), true);
+	CHECK(chunk.bytes() < 64, true);
+
+	// writing the same block must not expand the storage
+	chunk.setBlock(4, 5, 6, Block {1});
+	CHECK(chunk.uniform(), true);
+
+	chunk.setBlock(4, 5, 6, Block {2});
+	CHECK(chunk.uniform(), false);
+	CHECK(chunk.getBlock(4, 5, 6).block_type, 2);
+	CHECK(chunk.getBlock(4, 5, 7).block_type, 1);
+
+	// revert the change, now the only used entry should be collapsed
+	chunk.setBlock(4, 5, 6, Block {1});
+	chunk.compact();
+	CHECK(chunk.uniform(), true);
+	CHECK(chunk.getBlock(4, 5, 6).block_type, 1);
+
+	chunk.fill(Block {0});
+	CHECK(chunk.empty(), true);
+
+};
+
+TEST(world_chunk_occupancy) {
+
+	Chunk chunk {{0, 0, 0}};
+	std::mt19937 random {1337};
+
+	CHECK(chunk.count(), 0);
+	chunk.fill(Block {1});
+	CHECK(chunk.count(), Chunk::size * Chunk::size * Chunk::size);
+
+	for (int i = 0; i < 50000; i ++) {
+		int x = random() % Chunk::size;
+		int y = random() % Chunk::size;
+		int z = random() % Chunk::size;
+
+		chunk.setBlock(x, y, z, Block {random() % 3});
+	}
+
+	int count = 0;
+
+	for (int z = 0; z < Chunk::size; z ++) {
+		for (int x = 0; x < Chunk::size; x ++) {
+			uint32_t column = chunk.getColumnMask(x, z);
+
+			for (int y = 0; y < Chunk::size; y ++) {
+				bool solid = !chunk.getBlock(x, y, z).isAir();
+				count += solid;
+
+				if (solid != bool(column & (1u << y)) || solid != chunk.occupied(x, y, z)) {
+					FAIL("Chunk occupancy mask doesn't match the block storage");
+				}
+			}
+		}
+	}
+
+	CHECK(chunk.count(), count);
+
+	// carve out a box and check the sub-box queries
+	for (int z = 4; z <= 9; z ++) {
+		for (int y = 0; y < Chunk::size; y ++) {
+			chunk.setBlock(8, y, z, Block {0});
+		}
+	}
+
+	CHECK(chunk.empty({8, 0, 4}, {8, 31, 9}), true);
+	CHECK(chunk.empty({8, 3, 5}, {8, 7, 6}), true);
+	CHECK(chunk.empty({7, 0, 4}, {8, 31, 9}), false);
+
+	chunk.fill(Block {0});
+	CHECK(chunk.count(), 0);
+	CHECK(chunk.empty({0, 0, 0}, {31, 31, 31}), true);
+
+};
+
+TEST(world_chunk_snapshot) {
+
+	Chunk chunk {{0, 0, 0}};
+	chunk.setBlock(1, 2, 3, Block {1});
+
+	ChunkSnapshot first = chunk.snapshot();
+	CHECK(first.version, chunk.getVersion());
+
+	// snapshots of an unchanged chunk share the same data
+	ChunkSnapshot second = chunk.snapshot();
+	ASSERT(&*first == &*second);
+
+	chunk.setBlock(1, 2, 3, Block {2});
+	chunk.setBlock(4, 5, 6, Block {3});
+
+	// the write went to a copy, the snapshots still see the old content
+	CHECK(first->getBlock(1, 2, 3).packed(), 1);
+	CHECK(first->getBlock(4, 5, 6).packed(), 0);
+	CHECK(first->occupied(4, 5, 6), false);
+	CHECK(chunk.getBlock(1, 2, 3).packed(), 2);
+	CHECK(chunk.getBlock(4, 5, 6).packed(), 3);
+	CHECK(chunk.occupied(4, 5, 6), true);
+
+	ASSERT(first.version < chunk.getVersion());
+	ASSERT(&*chunk.snapshot() != &*first);
+
+	chunk.fill(Block {0});
+	CHECK(first->count(), 1);
+	CHECK(chunk.count(), 0);
+
+};
+
+TEST(world_chunk_dirty_slices) {
+
+	Chunk chunk {{0, 0, 0}};
+	chunk.setBlock(0, 0, 0, Block {1});
+	chunk.compact();
+
+	DirtySlices slices;
+	const uint64_t start = chunk.getVersion();
+
+	// nothing changed since the current version
+	ASSERT(chunk.getChanges(start, slices));
+	ASSERT(slices.empty());
+
+	// the block itself and the two neighbours on each axis at full detail,
+	// an odd coordinate means the block is not sampled by the lower detail level
+	chunk.setBlock(5, 0, 31, Block {2});
+	ASSERT(chunk.getChanges(start, slices));
+	CHECK(slices.masks[0][DirectionIndex::X], 0b111u << 4);
+	CHECK(slices.masks[0][DirectionIndex::Y], 0b11u);
+	CHECK(slices.masks[0][DirectionIndex::Z], 0b11u << 30);
+	ASSERT(!slices.contains(1, DirectionIndex::X));
+
+	// at half detail the block stands for two blocks along each axis
+	const uint64_t middle = chunk.getVersion();
+	chunk.setBlock(8, 8, 8, Block {3});
+	ASSERT(chunk.getChanges(middle, slices));
+	CHECK(slices.masks[0][DirectionIndex::Y], 0b111u << 7);
+	CHECK(slices.masks[1][DirectionIndex::Y], 0b1111u << 7);
+	ASSERT(!slices.contains(0, DirectionIndex::X, 5));
+
+	// both writes are seen from the older version
+	ASSERT(chunk.getChanges(start, slices));
+	ASSERT(slices.contains(0, DirectionIndex::X, 5));
+	ASSERT(slices.contains(0, DirectionIndex::X, 8));
+
+	// compact drops the history, only the current version can be compared with
+	chunk.compact();
+	ASSERT(!chunk.getChanges(start, slices));
+	ASSERT(chunk.getChanges(chunk.getVersion(), slices));
+	ASSERT(slices.empty());
+
+	// the history is started again by the next write
+	const uint64_t last = chunk.getVersion();
+	chunk.fill(Block {0});
+	ASSERT(chunk.getChanges(last, slices));
+	CHECK(slices.masks[1][DirectionIndex::Z], ~uint32_t {0});
+
+};
+
+TEST(world_chunk_bulk) {
+
+	Chunk bulk {{0, 0, 0}};
+	Chunk reference {{0, 0, 0}};
+
+	const auto compare = [&] () {
+		for (int z = 0; z < Chunk::size; z ++) {
+			for (int x = 0; x < Chunk::size; x ++) {
+				if (bulk.getColumnMask(x, z) != reference.getColumnMask(x, z)) {
+					FAIL("Bulk chunk write produced incorrect occupancy mask");
+				}
+
+				for (int y = 0; y < Chunk::size; y ++) {
+					if (bulk.getBlock(x, y, z) != reference.getBlock(x, y, z)) {
+						FAIL("Bulk chunk write produced incorrect block");
+					}
+				}
+			}
+		}
+	};
+
+	// leaving the uniform state through each of the writes
+	bulk.fillColumn(3, 7, 4, 10, Block {1});
+
+	for (int y = 4; y < 14; y ++) {
+		reference.setBlock(3, y, 7, Block {1});
+	}
+
+	compare();
+
+	bulk.fill({2, 0, 5}, {9, 31, 6}, Block {2});
+	bulk.fill({4, 2, 0}, {4, 2, 31}, Block {0});
+
+	for (int z = 0; z < Chunk::size; z ++) {
+		for (int y = 0; y < Chunk::size; y ++) {
+			for (int x = 0; x < Chunk::size; x ++) {
+				if (x >= 2 && x <= 9 && z >= 5 && z <= 6) reference.setBlock(x, y, z, Block {2});
+				if (x == 4 && y == 2) reference.setBlock(x, y, z, Block {0});
+			}
+		}
+	}
+
+	compare();
+
+	std::vector<Block> row;
+
+	for (int x = 0; x < Chunk::size; x ++) {
+		row.emplace_back(x / 3 % 4);
+		reference.setBlock(x, 30, 5, row.back());
+	}
+
+	bulk.setRow(30, 5, row.data());
+	compare();
+
+	// a fully solid column written into an uniform chunk
+	bulk.fill(Block {1});
+	reference.fill(Block {1});
+	bulk.fillColumn(0, 0, 0, Chunk::size, Block {0});
+
+	for (int y = 0; y < Chunk::size; y ++) {
+		reference.setBlock(0, y, 0, Block {0});
+	}
+
+	compare();
+	CHECK(bulk.count(), reference.count());
+
+	// writing the block the chunk is filled with must not expand the storage
+	bulk.fill(Block {1});
+	bulk.fill({1, 1, 1}, {8, 8, 8}, Block {1});
+	bulk.fillColumn(5, 5, 0, Chunk::size, Block {1});
+	CHECK(bulk.uniform(), true);
+
+	// an empty column run writes nothing, and doesn't count as a write
+	const uint64_t version = bulk.getVersion();
+	bulk.fillColumn(5, 5, 31, 0, Block {2});
+	CHECK(bulk.getVersion(), version);
+	CHECK(bulk.uniform(), true);
+
+	// the dirty slices of a box match those of the blocks in it
+	DirtySlices expected;
+	DirtySlices actual;
+
+	for (int z = 3; z <= 6; z ++) {
+		for (int y = 9; y <= 9; y ++) {
+			for (int x = 1; x <= 12; x ++) {
+				expected.mark(x, y, z);
+			}
+		}
+	}
+
+	actual.mark({1, 9, 3}, {12, 9, 6});
+
+	for (int level = 0; level < DirtySlices::levels; level ++) {
+		for (int axis = 0; axis < 3; axis ++) {
+			CHECK(actual.masks[level][axis], expected.masks[level][axis]);
+		}
+	}
+
+};
+
+TEST(world_column_heightmap) {
+
+	World world;
+
+	Chunk* lower = new Chunk({0, 0, 0});
+	lower->fill(Block {1});
+
+	Chunk* upper = new Chunk({0, 1, 0});
+	upper->setBlock(3, 4, 5, Block {2});
+
+	ASSERT(!world.getHeight(3, 5));
+
+	world.emplace(lower);
+	CHECK(*world.getHeight(3, 5), 31);
+
+	world.emplace(upper);
+	CHECK(*world.getHeight(3, 5), 36);
+	CHECK(*world.getHeight(0, 0), 31);
+
+	// removing the top block finds the next one below, even in a different chunk
+	world.setBlock(3, 36, 5, Block {0});
+	CHECK(*world.getHeight(3, 5), 31);
+
+	world.setBlock(3, 50, 5, Block {2});
+	CHECK(*world.getHeight(3, 5), 50);
+
+	world.fill({0, 20, 0}, {3, 31, 3}, Block {0});
+	CHECK(*world.getHeight(2, 2), 19);
+	CHECK(*world.getHeight(4, 4), 31);
+
+	world.fill({0, 0, 0}, {0, 31, 0}, Block {0});
+	ASSERT(!world.getHeight(0, 0));
+	ASSERT(!world.getHeight(-1, 0));
+
+	// the edits are applied in order, so the block placed first is removed again
+	std::vector<BlockEdit> edits {{{1, 40, 1}, Block {2}}, {{1, 40, 1}, Block {0}}, {{2, 45, 1}, Block {2}}};
+	world.apply(edits);
+	CHECK(*world.getHeight(1, 1), 19);
+	CHECK(*world.getHeight(2, 1), 45);
+
+	// unloading the upper chunk also removes its blocks from the heightmap
+	ChunkColumn column;
+	std::vector<std::shared_ptr<Chunk>> evicted;
+
+	Chunk* solid = new Chunk({0, 0, 0});
+	solid->fill(Block {1});
+	column.emplace(solid);
+
+	Chunk* floating = new Chunk({0, 2, 0});
+	floating->setBlock(7, 0, 7, Block {1});
+	column.emplace(floating);
+
+	CHECK(column.getHeight(7, 7), 64);
+	column.update(1, 0, evicted);
+	CHECK(evicted.size(), 1u);
+	CHECK(column.getHeight(7, 7), 31);
+
+	// replacing a chunk recomputes the heightmap
+	column.emplace(new Chunk({0, 0, 0}));
+	CHECK(column.getHeight(7, 7), (int) ChunkColumn::no_height);
+
+};
+
+TEST(world_fluid_flow) {
+
+	World world;
+	TaskPool pool {4};
+
+	for (int cz = 0; cz < 2; cz ++) {
+		for (int cx = 0; cx < 2; cx ++) {
+			world.emplace(new Chunk({cx, 0, cz}));
+		}
+	}
+
+	world.fill({0, 0, 0}, {63, 0, 63}, Block {1});
+	world.setBlock(27, 0, 10, Block {0});
+	world.setBlock(30, 1, 10, FluidSimulator::fluid(1, FluidSimulator::source));
+
+	int ticks = 0;
+
+	while (world.tickFluids(pool) > 0) {
+		if (ticks ++ > 100) FAIL("Fluid did not settle");
+	}
+
+	// settled fluid is not evaluated anymore
+	CHECK(world.getFluids().pending(), 0u);
+
+	// the fluid crosses the chunk border at x=32 and loses one unit per block
+	ASSERT(world.getBlock(30, 1, 10) == FluidSimulator::fluid(1, FluidSimulator::source));
+	ASSERT(world.getBlock(33, 1, 10) == FluidSimulator::fluid(1, 4));
+	ASSERT(world.getBlock(36, 1, 10) == FluidSimulator::fluid(1, 1));
+	ASSERT(world.getBlock(37, 1, 10) == Block {0});
+	ASSERT(world.getBlock(32, 1, 12) == FluidSimulator::fluid(1, 3));
+	ASSERT(world.getBlock(30, 2, 10) == Block {0});
+	CHECK(*world.getHeight(35, 10), 1);
+
+	// the fluid falls into the hole, and keeps flowing past it on the floor
+	ASSERT(world.getBlock(27, 0, 10) == FluidSimulator::fluid(1, FluidSimulator::falling));
+	ASSERT(world.getBlock(26, 1, 10) == FluidSimulator::fluid(1, 3));
+
+	// without the source everything drains away
+	world.setBlock(30, 1, 10, Block {0});
+	ticks = 0;
+
+	while (world.tickFluids(pool) > 0) {
+		if (ticks ++ > 100) FAIL("Fluid did not drain");
+	}
+
+	ASSERT(world.getBlock(33, 1, 10) == Block {0});
+	ASSERT(world.getBlock(27, 0, 10) == Block {0});
+	CHECK(*world.getHeight(35, 10), 0);
+
+};
+
+TEST(world_block_ticks) {
+
+	World world;
+	TaskPool pool {4};
+	BlockTicker& ticker = world.getTicker();
+
+	world.emplace(new Chunk({0, 0, 0}));
+	world.emplace(new Chunk({0, 1, 0}));
+	world.fill({0, 0, 0}, {31, 0, 31}, Block {1});
+
+	// falls one block per tick until it lands on something
+	ticker.setHandler(5, [] (TickContext& context, glm::ivec3 pos, Block block) {
+		glm::ivec3 below = pos + glm::ivec3 {0, -1, 0};
+
+		if (context.getBlock(below).isAir()) {
+			context.setBlock(pos, Block {0});
+			context.setBlock(below, block);
+			context.schedule(below, 1);
+		}
+	}, false);
+
+	// only ever ticked randomly, turns into a block with no handler
+	ticker.setHandler(6, [] (TickContext& context, glm::ivec3 pos, Block block) {
+		context.setBlock(pos, Block {7});
+	}, true);
+
+	world.setBlock(5, 40, 5, Block {5});
+	ticker.schedule({5, 40, 5}, 1);
+
+	Chunk* growing = new Chunk({1, 0, 0});
+	growing->fill(Block {6});
+	world.emplace(growing);
+
+	for (int i = 0; i < 100; i ++) {
+		world.tick(pool);
+	}
+
+	CHECK(ticker.getTime(), 100u);
+	CHECK(ticker.pending(), 0u);
+	CHECK(world.getBlock(5, 40, 5).block_type, 0);
+	CHECK(world.getBlock(5, 1, 5).block_type, 5);
+	CHECK(*world.getHeight(5, 5), 1);
+
+	int grown = 0;
+
+	for (int z = 0; z < Chunk::size; z ++) {
+		for (int y = 0; y < Chunk::size; y ++) {
+			for (int x = 0; x < Chunk::size; x ++) {
+				grown += world.getBlock(32 + x, y, z).block_type == 7;
+			}
+		}
+	}
+
+	// 24 samples per tick, a few can hit the same block twice
+	ASSERT(grown > 2000 && grown <= 2400);
+
+	// ticks scheduled in chunks that are not loaded are dropped
+	ticker.schedule({0, 100, 0}, 1);
+	world.tick(pool);
+	CHECK(ticker.pending(), 0u);
+
+};
+
+TEST(world_raycast) {
+
+	World world;
+	TaskPool pool {4};
+	std::mt19937 random {7};
+
+	// a layer of sparse chunks with one empty chunk, between two layers of empty chunks
+	for (int cx = -1; cx <= 1; cx ++) {
+		for (int cy = -1; cy <= 1; cy ++) {
+			for (int cz = -1; cz <= 1; cz ++) {
+				Chunk* chunk = new Chunk({cx, cy, cz});
+
+				if (cy == 0 && !(cx == 1 && cz == -1)) {
+					for (int i = 0; i < 96; i ++) {
+						int x = random() % Chunk::size;
+						int y = random() % Chunk::size;
+						int z = random() % Chunk::size;
+
+						chunk->setBlock(x, y, z, Block {1});
+					}
+				}
+
+				world.emplace(chunk);
+			}
+		}
+	}
+
+	world.getChunk(0, 0, 0).lock()->fill({8, 8, 8}, {11, 11, 11}, Block {1});
+
+	// the plain block by block walk, with the same conventions as World::raycast
+	const auto walk = [&] (glm::vec3 from, glm::vec3 direction, float distance) -> Raycast {
+		const glm::vec3 origin = from + 0.5f;
+		const glm::vec3 normal = glm::normalize(direction);
+		const glm::ivec3 step = glm::sign(normal);
+		const glm::vec3 delta = glm::abs(1.0f / normal);
+
+		glm::ivec3 pos = glm::floor(origin);
+		glm::ivec3 last = pos;
+		glm::vec3 max;
+
+		for (int i = 0; i < 3; i ++) {
+			max[i] = step[i] == 0 ? INFINITY : ((step[i] > 0 ? pos[i] + 1 : pos[i]) - origin[i]) / normal[i];
+		}
+
+		float travelled = 0;
+
+		while (travelled <= distance) {
+			std::shared_ptr<Chunk> chunk = world.getChunk(pos.x >> Chunk::bits, pos.y >> Chunk::bits, pos.z >> Chunk::bits).lock();
+
+			if (!chunk) {
+				return {Raycast::UNLOADED, pos, last};
+			}
+
+			if (chunk->occupied(pos.x & Chunk::mask, pos.y & Chunk::mask, pos.z & Chunk::mask)) {
+				return {pos, last};
+			}
+
+			last = pos;
+			int axis = (max.x < max.y) ? (max.x < max.z ? 0 : 2) : (max.y < max.z ? 1 : 2);
+
+			travelled = max[axis];
+			pos[axis] += step[axis];
+			max[axis] += delta[axis];
+		}
+
+		return {};
+	};
+
+	std::uniform_real_distribution<float> unit {-1, 1};
+	std::vector<Ray> rays;
+
+	// rays in all directions, crossing the empty bricks, the empty chunks and the chunk borders
+	for (int i = 0; i < 2000; i ++) {
+		glm::vec3 from {unit(random) * 40 + 16, (unit(random) + 1) * 16, unit(random) * 40 + 16};
+		glm::vec3 direction {unit(random), unit(random), unit(random)};
+		float distance = 20 + (unit(random) + 1) * 40;
+
+		rays.push_back({from, direction, distance});
+	}
+
+	// and along the axes, where the other two never change
+	for (int i = 0; i < 64; i ++) {
+		glm::vec3 from {unit(random) * 40 + 16, (unit(random) + 1) * 16, unit(random) * 40 + 16};
+		glm::vec3 direction {0};
+		direction[i % 3] = (i / 3 % 2) ? 1 : -1;
+
+		rays.push_back({from, direction, 100});
+	}
+
+	std::vector<Raycast> many = world.raycastMany(pool, rays);
+	int counts[3] {};
+
+	for (size_t i = 0; i < rays.size(); i ++) {
+		Raycast expected = walk(rays[i].from, rays[i].direction, rays[i].distance);
+		counts[expected.getType()] ++;
+
+		for (const Raycast& actual : {world.raycast(rays[i].from, rays[i].direction, rays[i].distance), many[i]}) {
+			if (actual.getType() != expected.getType()) {
+				FAIL("Raycast returned a different result type");
+			}
+
+			if (expected.getType() != Raycast::MISS && (actual.getPos() != expected.getPos() || actual.getTarget() != expected.getTarget())) {
+				FAIL("Raycast returned a different position");
+			}
+		}
+	}
+
+	ASSERT(counts[Raycast::MISS] > 0);
+	ASSERT(counts[Raycast::HIT] > 0);
+	ASSERT(counts[Raycast::UNLOADED] > 0);
+
+};
+
+TEST(world_apply) {
+
+	World world;
+
+	// the center chunks of this box have all their neighbours loaded, so their updates are not dropped
+	for (int cx = -2; cx <= 2; cx ++) {
+		for (int cy = -1; cy <= 1; cy ++) {
+			for (int cz = -1; cz <= 1; cz ++) {
+				world.emplace(new Chunk({cx, cy, cz}));
+			}
+		}
+	}
+
+	// the chunks updated since the last call, and if the update was important
+	const auto consume = [&] () {
+		ankerl::unordered_dense::map<glm::ivec3, bool> updated;
+
+		world.consumeUpdates([&] (WorldView&& view, bool important, bool restored) {
+			if (updated.contains(view.origin())) {
+				FAIL("Chunk updated more than once");
+			}
+
+			updated[view.origin()] = important;
+		});
+
+		return updated;
+	};
+
+	consume();
+
+	const auto throws = [] (const auto& func) {
+		try {
+			func();
+		} catch (AccessError&) {
+			return true;
+		}
+
+		return false;
+	};
+
+	// nothing is written if any of the chunks is not loaded
+	const uint64_t version = world.getChunk(0, 0, 0).lock()->getVersion();
+	const std::vector<BlockEdit> invalid {{{5, 5, 5}, Block {1}}, {{1000, 5, 5}, Block {1}}, {{6, 5, 5}, Block {1}}};
+
+	ASSERT(throws([&] () { world.apply(invalid); }));
+	CHECK(world.getBlock(5, 5, 5).isAir(), true);
+	CHECK(world.getBlock(6, 5, 5).isAir(), true);
+	CHECK(world.getChunk(0, 0, 0).lock()->getVersion(), version);
+	CHECK(consume().size(), 0u);
+
+	// many edits in the same chunks make one update per chunk
+	std::vector<BlockEdit> edits;
+
+	for (int i = 0; i < 16; i ++) {
+		edits.push_back({{4 + i, 8, 8}, Block {1}});
+		edits.push_back({{36 + i, 8, 8}, Block {2}});
+	}
+
+	world.apply(edits);
+	CHECK(world.getBlock(19, 8, 8).block_type, 1);
+	CHECK(world.getBlock(51, 8, 8).block_type, 2);
+
+	auto updated = consume();
+	CHECK(updated.size(), 2u);
+	ASSERT(updated[{0, 0, 0}]);
+	ASSERT(updated[{1, 0, 0}]);
+
+	// removing a block on the chunk border also updates the neighbour, placing one doesn't
+	world.apply(std::vector<BlockEdit> {{{31, 8, 8}, Block {1}}});
+	updated = consume();
+	CHECK(updated.size(), 1u);
+	ASSERT(updated.contains({0, 0, 0}));
+
+	world.apply(std::vector<BlockEdit> {{{31, 8, 8}, Block {0}}});
+	updated = consume();
+	CHECK(updated.size(), 2u);
+	ASSERT(updated.contains({0, 0, 0}));
+	ASSERT(updated.contains({1, 0, 0}));
+
+	// and a block inside the chunk only updates that chunk
+	world.apply(std::vector<BlockEdit> {{{8, 8, 8}, Block {0}}});
+	updated = consume();
+	CHECK(updated.size(), 1u);
+	ASSERT(updated.contains({0, 0, 0}));
+
+};
+
+TEST(world_fill) {
+
+	World world;
+
+	for (int cx = -2; cx <= 2; cx ++) {
+		for (int cy = -1; cy <= 1; cy ++) {
+			for (int cz = -1; cz <= 1; cz ++) {
+				world.emplace(new Chunk({cx, cy, cz}));
+			}
+		}
+	}
+
+	const auto consume = [&] () {
+		ankerl::unordered_dense::map<glm::ivec3, bool> updated;
+
+		world.consumeUpdates([&] (WorldView&& view, bool important, bool restored) {
+			if (updated.contains(view.origin())) {
+				FAIL("Chunk updated more than once");
+			}
+
+			updated[view.origin()] = important;
+		});
+
+		return updated;
+	};
+
+	consume();
+
+	// nothing is written if any of the chunks is not loaded
+	const uint64_t version = world.getChunk(1, 0, 0).lock()->getVersion();
+	bool thrown = false;
+
+	try {
+		world.fill({40, 2, 2}, {120, 4, 4}, Block {1});
+	} catch (AccessError&) {
+		thrown = true;
+	}
+
+	ASSERT(thrown);
+	CHECK(world.getBlock(40, 2, 2).isAir(), true);
+	CHECK(world.getChunk(1, 0, 0).lock()->getVersion(), version);
+	CHECK(consume().size(), 0u);
+
+	// a box spanning two chunks makes one update for each of them
+	world.fill({20, 2, 2}, {40, 4, 4}, Block {1});
+	CHECK(world.getBlock(20, 2, 2).block_type, 1);
+	CHECK(world.getBlock(40, 4, 4).block_type, 1);
+
+	auto updated = consume();
+	CHECK(updated.size(), 2u);
+	ASSERT(updated[{0, 0, 0}]);
+	ASSERT(updated[{1, 0, 0}]);
+
+	// clearing a box that touches the chunk border also updates the neighbour across it
+	world.fill({0, 10, 10}, {3, 12, 12}, Block {0});
+	updated = consume();
+	CHECK(updated.size(), 2u);
+	ASSERT(updated.contains({0, 0, 0}));
+	ASSERT(updated.contains({-1, 0, 0}));
+
+	// but not if it's inside the chunk
+	world.fill({4, 10, 10}, {8, 12, 12}, Block {0});
+	updated = consume();
+	CHECK(updated.size(), 1u);
+	ASSERT(updated.contains({0, 0, 0}));
+
+};
+
+TEST(world_memory_budget) {
+
+	Chunk chunk {{0, 0, 0}};
+	size_t empty = chunk.memory();
+
+	chunk.setBlock(1, 2, 3, Block {1});
+	ASSERT(chunk.memory() > empty);
+
+	WorldGenerator generator {1};
+	World world;
+
+	// every column in range is already loaded, so the update has nothing to generate
+	for (int z = -2; z <= 2; z ++) {
+		for (int x = -2; x <= 2; x ++) {
+			Chunk* chunk = new Chunk({x, 0, z});
+			chunk->setBlock(x + 2, 0, z + 2, Block {1});
+			world.emplace(chunk);
+		}
+	}
+
+	world.update(generator, {0, 0, 0}, {0, 0, 1}, 2.9, 1);
+	CHECK(world.getLoadedChunks(), 25u);
+
+	size_t usage = world.getMemoryUsage();
+	ASSERT(usage > 25 * empty);
+
+	// the corners go first, then the rest of the outer ring
+	world.setMemoryBudget(usage * 2 / 3);
+	world.update(generator, {0, 0, 0}, {0, 0, 1}, 2.9, 1);
+
+	CHECK(world.getLoadedChunks(), 13u);
+	ASSERT(world.getMemoryUsage() <= usage * 2 / 3);
+	ASSERT(world.getChunk(2, 0, 0).lock());
+	ASSERT(world.getChunk(1, 0, 1).lock());
+	ASSERT(!world.getChunk(2, 0, 1).lock());
+	ASSERT(!world.getChunk(2, 0, 2).lock());
+
+	// the outer ring doesn't fit, so once everything in range is loaded the view distance must not grow back into it
+	for (int i = 0; i < 4; i ++) {
+		do {
+			world.update(generator, {0, 0, 0}, {0, 0, 1}, 2.9, 1);
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		} while (world.getScheduler().pending() != 0 || world.getScheduler().active() != 0);
+	}
+
+	CHECK(world.getLoadedChunks(), 13u);
+
+};
+
+TEST(world_generator_cache) {
+
+	WorldGenerator uncached {42, 0};
+	WorldGenerator cached {42, 1};
+
+	// the second column evicts the first one, which is then computed again
+	for (glm::ivec3 pos : {glm::ivec3 {0, 0, 0}, glm::ivec3 {0, -1, 0}, glm::ivec3 {1, 0, 0}, glm::ivec3 {0, 1, 0}}) {
+		std::unique_ptr<Chunk> expected {uncached.terrain(pos)};
+		std::unique_ptr<Chunk> actual {cached.terrain(pos)};
+
+		for (int z = 0; z < Chunk::size; z ++) {
+			for (int y = 0; y < Chunk::size; y ++) {
+				for (int x = 0; x < Chunk::size; x ++) {
+					if (expected->getBlock(x, y, z) != actual->getBlock(x, y, z)) {
+						FAIL("Cached column noise produced a different chunk");
+					}
+				}
+			}
+		}
+	}
+
+};
+
+TEST(world_generator_density) {
+
+	WorldGenerator full {42};
+	WorldGenerator coarse {42};
+	coarse.setDensity(WorldGenerator::Density::COARSE_4);
+
+	size_t solid = 0;
+	size_t different = 0;
+
+	for (int cy = -2; cy <= 1; cy ++) {
+		std::unique_ptr<Chunk> expected {full.terrain({0, cy, 0})};
+		std::unique_ptr<Chunk> actual {coarse.terrain({0, cy, 0})};
+
+		for (int z = 0; z < Chunk::size; z ++) {
+			for (int y = 0; y < Chunk::size; y ++) {
+				for (int x = 0; x < Chunk::size; x ++) {
+					bool same = expected->getBlock(x, y, z) == actual->getBlock(x, y, z);
+
+					// the noise on the lattice points is not interpolated, so those must match exactly
+					if (!same && x % 4 == 0 && y % 4 == 0 && z % 4 == 0) {
+						FAIL("Coarse density changed a block on the lattice");
+					}
+
+					solid += !expected->getBlock(x, y, z).isAir();
+					different += !same;
+				}
+			}
+		}
+	}
+
+	// the interpolation smooths out the smallest features, but the terrain should stay mostly the same
+	ASSERT(solid > 0);
+	ASSERT(different * 10 < solid);
+
+};
+
+TEST(world_generator_classify) {
+
+	WorldGenerator generator {42};
+
+	// far above the terrain the chunks are returned without any writes
+	std::unique_ptr<Chunk> sky {generator.terrain({0, 2, 0})};
+	ASSERT(sky->empty());
+
+	// deep below it they start out as solid stone, and only the caves are carved out
+	std::unique_ptr<Chunk> buried {generator.terrain({0, -3, 0})};
+	int stone = 0;
+
+	for (int z = 0; z < Chunk::size; z ++) {
+		for (int y = 0; y < Chunk::size; y ++) {
+			for (int x = 0; x < Chunk::size; x ++) {
+				Block block = buried->getBlock(x, y, z);
+				ASSERT(block == Block {1} || block.isAir());
+				stone += !block.isAir();
+			}
+		}
+	}
+
+	CHECK(buried->count(), stone);
+	ASSERT(stone > Chunk::size * Chunk::size * Chunk::size / 2);
+
+};
+
+TEST(world_generation_pipeline) {
+
+	WorldGenerator generator {42};
+	WorldGenerator reference {42};
+
+	const auto indexOf = [] (glm::ivec3 pos, int radius) {
+		const int width = 2 * radius + 1;
+		return (pos.x + radius) + (pos.y + radius) * width + (pos.z + radius) * width * width;
+	};
+
+	// run the stages by hand, each one over the neighbourhood the next one needs
+	std::vector<std::unique_ptr<Chunk>> chunks;
+	std::vector<ChunkSnapshot> terrain;
+	std::vector<ChunkSnapshot> carved (27);
+
+	for (int i = 0; i < 125; i ++) {
+		chunks.emplace_back(reference.terrain({i % 5 - 2, i / 5 % 5 - 2, i / 25 - 2}));
+		terrain.push_back(chunks.back()->snapshot());
+	}
+
+	const auto neighbourhood = [&] (glm::ivec3 pos, const std::vector<ChunkSnapshot>& snapshots, int radius, const ChunkData* around[27]) {
+		for (int i = 0; i < 27; i ++) {
+			around[i] = &*snapshots[indexOf(pos + glm::ivec3 {i % 3 - 1, i / 3 % 3 - 1, i / 9 - 1}, radius)];
+		}
+	};
+
+	for (int i = 0; i < 27; i ++) {
+		glm::ivec3 pos {i % 3 - 1, i / 3 % 3 - 1, i / 9 - 1};
+		const ChunkData* around[27];
+
+		neighbourhood(pos, terrain, 2, around);
+		Chunk& chunk = *chunks[indexOf(pos, 2)];
+		reference.carve(chunk, around);
+		carved[i] = chunk.snapshot();
+	}
+
+	const ChunkData* around[27];
+	neighbourhood({0, 0, 0}, carved, 1, around);
+	Chunk& expected = *chunks[indexOf({0, 0, 0}, 2)];
+	reference.decorate(expected, around);
+
+	std::unique_ptr<Chunk> actual {generator.get({0, 0, 0})};
+
+	// the generator output doesn't need to be saved
+	CHECK(actual->isModified(), false);
+
+	for (int z = 0; z < Chunk::size; z ++) {
+		for (int y = 0; y < Chunk::size; y ++) {
+			for (int x = 0; x < Chunk::size; x ++) {
+				if (expected.getBlock(x, y, z) != actual->getBlock(x, y, z)) {
+					FAIL("Pipeline produced a different chunk");
+				}
+			}
+		}
+	}
+
+	// every stage ran exactly once for each chunk that needed it
+	const GenerationPipeline& pipeline = generator.getPipeline();
+	CHECK(pipeline.getStageJobs(GenerationPipeline::TERRAIN), 125u);
+	CHECK(pipeline.getStageJobs(GenerationPipeline::CARVING), 27u);
+	CHECK(pipeline.getStageJobs(GenerationPipeline::DECORATION), 1u);
+
+};
+
+TEST(world_mesher_binary) {
+
+	World world;
+	std::mt19937 random {42};
+
+	// the chunk and its face neighbours, filled with noise, with more air towards the top
+	for (glm::ivec3 pos : {glm::ivec3 {0, 0, 0}, {-1, 0, 0}, {1, 0, 0}, {0, -1, 0}, {0, 1, 0}, {0, 0, -1}, {0, 0, 1}}) {
+		Chunk* chunk = new Chunk(pos);
+
+		for (int z = 0; z < Chunk::size; z ++) {
+			for (int y = 0; y < Chunk::size; y ++) {
+				for (int x = 0; x < Chunk::size; x ++) {
+					if ((int) (random() % (Chunk::size * 2)) > pos.y * Chunk::size + y) {
+						chunk->setBlock(x, y, z, Block {1 + random() % 4});
+					}
+				}
+			}
+		}
+
+		world.emplace(chunk);
+	}
+
+	// a clay block on our top layer with open sides and air above it, in the +Y neighbour
+	std::shared_ptr<Chunk> center = world.getChunk(0, 0, 0).lock();
+	std::shared_ptr<Chunk> above = world.getChunk(0, 1, 0).lock();
+
+	center->fill({9, 31, 9}, {11, 31, 11}, Block {0});
+	center->setBlock(10, 31, 10, Block {2});
+	above->setBlock(10, 0, 10, Block {0});
+
+	const TerrainSprites sprites {1, 2, 3, 4};
+
+	// the visible faces covered by the full detail mesh, and their sprites
+	const auto rasterize = [] (MeshEmitterSet& emitters) {
+		std::map<std::tuple<int, int, int, int>, uint32_t> faces;
+
+		for (int direction = 0; direction < 6; direction ++) {
+			const std::vector<VertexTerrain>& vertices = emitters.get(direction).getVertexData();
+
+			for (size_t quad = 0; quad < vertices.size(); quad += 6) {
+				glm::vec3 low {+1000};
+				glm::vec3 high {-1000};
+
+				for (size_t i = quad; i < quad + 6; i ++) {
+					low = glm::min(low, glm::vec3 {vertices[i].x, vertices[i].y, vertices[i].z});
+					high = glm::max(high, glm::vec3 {vertices[i].x, vertices[i].y, vertices[i].z});
+				}
+
+				// the quads span whole blocks along the other two axes, and the face plane is half a block away from the block centers
+				const int axis = direction / 2;
+				glm::ivec3 from, to;
+
+				for (int i = 0; i < 3; i ++) {
+					from[i] = std::lround(i == axis ? low[i] + ((direction % 2) ? -0.5f : 0.5f) : low[i] + 0.5f);
+					to[i] = i == axis ? from[i] : std::lround(high[i] - 0.5f);
+				}
+
+				for (int z = from.z; z <= to.z; z ++) {
+					for (int y = from.y; y <= to.y; y ++) {
+						for (int x = from.x; x <= to.x; x ++) {
+							faces[{direction, x, y, z}] = vertices[quad].i;
+						}
+					}
+				}
+			}
+		}
+
+		return faces;
+	};
+
+	WorldView view = world.getView({0, 0, 0}, Direction::ALL);
+	view.capture();
+
+	MeshEmitterSet reference_emitters {1024};
+	MeshEmitterSet binary_emitters {1024};
+	ChunkFaceBuffer face_buffer;
+	ChunkMaskBuffer mask_buffer;
+
+	auto reference_planes = std::make_unique<ChunkPlaneMesh>();
+	auto binary_planes = std::make_unique<ChunkPlaneMesh>();
+
+	GreedyMesher::emitChunk(reference_emitters, face_buffer, view, sprites, *reference_planes);
+	GreedyMesher::emitChunk(binary_emitters, mask_buffer, view, sprites, *binary_planes);
+
+	auto reference = rasterize(reference_emitters);
+	auto binary = rasterize(binary_emitters);
+
+	// both meshes can also cover some of the hidden faces, but the visible ones need to be the same
+	int visible = 0;
+
+	for (int direction = 0; direction < 6; direction ++) {
+		glm::ivec3 offset {0};
+		offset[direction / 2] = (direction % 2) ? 1 : -1;
+
+		for (int z = 0; z < Chunk::size; z ++) {
+			for (int y = 0; y < Chunk::size; y ++) {
+				for (int x = 0; x < Chunk::size; x ++) {
+					if (view.isAir(x, y, z) || !view.isAir(x + offset.x, y + offset.y, z + offset.z)) {
+						continue;
+					}
+
+					auto expected = reference.find({direction, x, y, z});
+					auto actual = binary.find({direction, x, y, z});
+
+					if (expected == reference.end() || actual == binary.end() || expected->second != actual->second) {
+						FAIL("Binary mesher produced different visible faces");
+					}
+
+					visible ++;
+				}
+			}
+		}
+	}
+
+	ASSERT(visible > 0);
+
+	// and no mesh covers any face of an air block
+	for (auto* faces : {&reference, &binary}) {
+		for (auto& [key, sprite] : *faces) {
+			if (view.isAir(std::get<1>(key), std::get<2>(key), std::get<3>(key))) {
+				FAIL("Mesher covered a face of an air block");
+			}
+		}
+	}
+
+	CHECK(binary[{DirectionIndex::WEST, 10, 31, 10}], (uint32_t) sprites.side);
+
+	// covering the block from the +Y neighbour changes its side sprites, so the incremental
+	// remesh has to include the side faces under the changed column and match a full remesh
+	above->setBlock(10, 0, 10, Block {1});
+
+	WorldView changed = world.getView({0, 0, 0}, Direction::ALL);
+	changed.capture();
+
+	const DirtySlices slices = binary_planes->getChanges(changed);
+	ASSERT(slices.contains(0, DirectionIndex::X, 10));
+	ASSERT(slices.contains(0, DirectionIndex::Z, 10));
+
+	auto full_planes = std::make_unique<ChunkPlaneMesh>();
+	MeshEmitterSet full_emitters {1024};
+
+	GreedyMesher::emitChunk(full_emitters, mask_buffer, changed, sprites, *full_planes);
+	GreedyMesher::emitChunk(binary_emitters, mask_buffer, changed, sprites, *binary_planes);
+	GreedyMesher::emitChunk(reference_emitters, face_buffer, changed, sprites, *reference_planes);
+
+	auto full = rasterize(full_emitters);
+	binary = rasterize(binary_emitters);
+	reference = rasterize(reference_emitters);
+
+	CHECK(full[{DirectionIndex::WEST, 10, 31, 10}], (uint32_t) sprites.clay);
+	CHECK(binary[{DirectionIndex::WEST, 10, 31, 10}], (uint32_t) sprites.clay);
+	CHECK(reference[{DirectionIndex::WEST, 10, 31, 10}], (uint32_t) sprites.clay);
+	ASSERT(binary == full);
+
+};
+
+TEST(world_storage_region) {
+
+	std::filesystem::path directory = std::filesystem::temp_directory_path() / "vlt3d-test-region";
+	std::filesystem::remove_all(directory);
+
+	std::mt19937 random {42};
+	std::vector<std::shared_ptr<Chunk>> chunks;
+
+	// chunks in two different regions, one of them uniform
+	for (int i = 0; i < 4; i ++) {
+		std::shared_ptr<Chunk> chunk {new Chunk {{i * 3, -1, 0}}};
+
+		if (i == 0) {
+			chunk->fill(Block {5});
+		}
+
+		for (int j = 0; i != 0 && j < 2000 * i; j ++) {
+			chunk->setBlock(random() % Chunk::size, random() % Chunk::size, random() % Chunk::size, Block {random() % 4});
+		}
+
+		chunks.push_back(chunk);
+	}
+
+	// writes go through the codec and the region file
+	{
+		RegionStore store {directory};
+
+		// the first (empty) version should be overwritten
+		for (auto& chunk : chunks) {
+			store.save(std::shared_ptr<Chunk> {new Chunk {chunk->pos}});
+			store.save(chunk);
+		}
+
+		store.flush();
+	}
+
+	RegionStore store {directory};
+	ASSERT(store.load({100, 0, 0}) == nullptr);
+
+	for (auto& chunk : chunks) {
+		std::unique_ptr<Chunk> loaded {store.load(chunk->pos)};
+		ASSERT(loaded != nullptr);
+		CHECK(loaded->isModified(), false);
+
+		for (int z = 0; z < Chunk::size; z ++) {
+			for (int y = 0; y < Chunk::size; y ++) {
+				for (int x = 0; x < Chunk::size; x ++) {
+					if (loaded->getBlock(x, y, z) != chunk->getBlock(x, y, z)) {
+						FAIL("Loaded chunk doesn't match the stored one");
+					}
+				}
+			}
+		}
+	}
+
+	std::vector<uint8_t> garbage {1, 1, 0, 0};
+	EXPECT(Exception, {
+		ChunkCodec::decode({0, 0, 0}, garbage.data(), garbage.size());
+	});
+
+	std::filesystem::remove_all(directory);
+
+};
+
+TEST(world_storage_cache) {
+
+	ChunkCache cache {16 * 1024 * 1024};
+
+	for (int i = 0; i < 4; i ++) {
+		std::shared_ptr<Chunk> chunk {new Chunk {{i, 0, 0}}};
+
+		for (int y = 0; y < Chunk::size; y ++) {
+			chunk->setBlock(i, y, 0, Block {(uint64_t) y});
+		}
+
+		cache.put(chunk);
+	}
+
+	CHECK(cache.size(), 4);
+	ASSERT(cache.take({5, 0, 0}) == nullptr);
+	CHECK(cache.misses(), 1);
+
+	std::unique_ptr<Chunk> chunk {cache.take({3, 0, 0})};
+	ASSERT(chunk != nullptr);
+	CHECK(cache.hits(), 1);
+	CHECK(chunk->getBlock(3, 7, 0).packed(), 7);
+	CHECK(chunk->getBlock(0, 7, 0).packed(), 0);
+
+	// taken entries are no longer cached
+	ASSERT(cache.take({3, 0, 0}) == nullptr);
+	CHECK(cache.size(), 3);
+
+	// nothing fits into an empty budget
+	ChunkCache empty {0};
+	empty.put(std::shared_ptr<Chunk> {new Chunk {{0, 0, 0}}});
+	CHECK(empty.size(), 0);
+	CHECK(empty.bytes(), 0);
+
+};
+
+TEST(world_scheduler) {
+
+	std::mutex mutex;
+	ankerl::unordered_dense::map<glm::ivec3, int> loads;
+
+	LoadScheduler scheduler {2, 4};
+
+	const auto loaded = [&] (glm::ivec3 pos) {
+		std::lock_guard lock {mutex};
+		return loads.contains(pos);
+	};
+
+	const auto load = [&] (glm::ivec3 pos) {
+		std::lock_guard lock {mutex};
+		loads[pos] ++;
+	};
+
+	const auto settle = [&] (glm::ivec3 center) {
+		do {
+			scheduler.update(center, {0, 0, 1}, 4, 2, loaded, load);
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		} while (scheduler.pending() != 0 || scheduler.active() != 0);
+	};
+
+	// chunks within the sphere of radius 4 and less than 2 layers away from the center
+	const auto expected = [] () {
+		size_t count = 0;
+
+		for (int x = -4; x <= 4; x ++) {
+			for (int y = -1; y <= 1; y ++) {
+				for (int z = -4; z <= 4; z ++) {
+					count += (x * x + y * y + z * z < 16);
+				}
+			}
+		}
+
+		return count;
+	};
+
+	settle({0, 0, 0});
+	CHECK(loads.size(), expected());
+
+	// moving by one chunk only adds the newly visible chunks
+	settle({1, 0, 0});
+
+	for (auto [pos, count] : loads) {
+		if (count != 1) {
+			FAIL("Chunk loaded more than once");
+		}
+	}
+
+	for (int z = -2; z <= 2; z ++) {
+		ASSERT(loads.contains({4, 0, z}));
+	}
+
+	ASSERT(!loads.contains({4, 0, 3}));
+
+};
+
+TEST(world_scheduler_cancel) {
+
+	std::mutex mutex;
+	ankerl::unordered_dense::map<glm::ivec3, int> loads;
+	std::atomic<int> started = 0;
+	std::atomic<bool> release = false;
+
+	LoadScheduler scheduler {1, 4};
+
+	const auto loaded = [&] (glm::ivec3 pos) {
+		std::lock_guard lock {mutex};
+		return loads.contains(pos);
+	};
+
+	const auto load = [&] (glm::ivec3 pos) {
+		started ++;
+
+		while (!release) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+
+		std::lock_guard lock {mutex};
+		loads[pos] ++;
+	};
+
+	// with radius 1 and a single layer only the center chunk is in range
+	scheduler.update({0, 0, 0}, {0, 0, 1}, 1, 1, loaded, load);
+
+	while (started == 0) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+
+	// leaving cancels the requests, but the started one has to stay scheduled
+	// until it completes, so coming back doesn't load the same chunk again
+	scheduler.update({10, 0, 0}, {0, 0, 1}, 1, 1, loaded, load);
+	scheduler.update({0, 0, 0}, {0, 0, 1}, 1, 1, loaded, load);
+	CHECK(scheduler.active(), 1);
+
+	release = true;
+
+	do {
+		scheduler.update({0, 0, 0}, {0, 0, 1}, 1, 1, loaded, load);
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	} while (scheduler.pending() != 0 || scheduler.active() != 0);
+
+	CHECK(loads.size(), 1);
+	CHECK(loads[{0, 0, 0}], 1);
+
+};
@@ -0,0 +1,389 @@
+
+#include "noise.hpp"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#	define NOISE_X86
+#	include <immintrin.h>
+#	define TARGET_SSE4 __attribute__((target("sse4.1")))
+#	define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+// siv computes the 2D noise as a slice of the 3D noise at this depth
+#ifdef SIVPERLIN_DEFAULT_Z
+static constexpr double default_z = SIVPERLIN_DEFAULT_Z;
+#else
+static constexpr double default_z = 0.34567;
+#endif
+
+// one call worth of points, the octaves scale all the coordinates except for a constant depth
+struct NoiseBatch {
+	const double* x;
+	const double* y;
+	NULLABLE const double* z;
+	double* out;
+	size_t count;
+	int octaves;
+	double persistence;
+	bool remap;
+};
+
+/*
+ * Scalar
+ */
+
+static double fade(double t) {
+	return t * t * t * (t * (t * 6 - 15) + 10);
+}
+
+static double lerp(double a, double b, double t) {
+	return a + (b - a) * t;
+}
+
+static double grad(int32_t hash, double x, double y, double z) {
+	const int32_t h = hash & 15;
+	const double u = h < 8 ? x : y;
+	const double v = h < 4 ? y : h == 12 || h == 14 ? x : z;
+	return ((h & 1) == 0 ? u : -u) + ((h & 2) == 0 ? v : -v);
+}
+
+static double sample(const int32_t* p, double x, double y, double z) {
+	const double fx = std::floor(x);
+	const double fy = std::floor(y);
+	const double fz = std::floor(z);
+
+	const int32_t ix = (int32_t) fx & 255;
+	const int32_t iy = (int32_t) fy & 255;
+	const int32_t iz = (int32_t) fz & 255;
+
+	x -= fx;
+	y -= fy;
+	z -= fz;
+
+	const double u = fade(x);
+	const double v = fade(y);
+	const double w = fade(z);
+
+	const int32_t a = (p[ix] + iy) & 255;
+	const int32_t b = (p[(ix + 1) & 255] + iy) & 255;
+	const int32_t aa = (p[a] + iz) & 255;
+	const int32_t ab = (p[(a + 1) & 255] + iz) & 255;
+	const int32_t ba = (p[b] + iz) & 255;
+	const int32_t bb = (p[(b + 1) & 255] + iz) & 255;
+
+	const double q0 = lerp(grad(p[aa], x, y, z), grad(p[ba], x - 1, y, z), u);
+	const double q1 = lerp(grad(p[ab], x, y - 1, z), grad(p[bb], x - 1, y - 1, z), u);
+	const double q2 = lerp(grad(p[(aa + 1) & 255], x, y, z - 1), grad(p[(ba + 1) & 255], x - 1, y, z - 1), u);
+	const double q3 = lerp(grad(p[(ab + 1) & 255], x, y - 1, z - 1), grad(p[(bb + 1) & 255], x - 1, y - 1, z - 1), u);
+
+	return lerp(lerp(q0, q1, v), lerp(q2, q3, v), w);
+}
+
+static void evaluateScalar(const int32_t* p, const NoiseBatch& batch, size_t from) {
+	for (size_t i = from; i < batch.count; i ++) {
+		double x = batch.x[i];
+		double y = batch.y[i];
+		double z = batch.z ? batch.z[i] : default_z;
+		double result = 0;
+		double amplitude = 1;
+
+		for (int octave = 0; octave < batch.octaves; octave ++) {
+			result += sample(p, x, y, z) * amplitude;
+			x *= 2;
+			y *= 2;
+			z *= batch.z ? 2 : 1;
+			amplitude *= batch.persistence;
+		}
+
+		if (batch.remap) {
+			result = result <= -1 ? 0 : result >= 1 ? 1 : result * 0.5 + 0.5;
+		}
+
+		batch.out[i] = result;
+	}
+}
+
+#ifdef NOISE_X86
+
+/*
+ * SSE4.1
+ */
+
+// the same steps as the scalar code, two points at a time, there is no gather so the hashing is done lane by lane
+TARGET_SSE4 static __m128d fadeSSE4(__m128d t) {
+	const __m128d cube = _mm_mul_pd(_mm_mul_pd(t, t), t);
+	return _mm_mul_pd(cube, _mm_add_pd(_mm_mul_pd(t, _mm_sub_pd(_mm_mul_pd(t, _mm_set1_pd(6)), _mm_set1_pd(15))), _mm_set1_pd(10)));
+}
+
+TARGET_SSE4 static __m128d lerpSSE4(__m128d a, __m128d b, __m128d t) {
+	return _mm_add_pd(a, _mm_mul_pd(_mm_sub_pd(b, a), t));
+}
+
+TARGET_SSE4 static __m128d gradSSE4(const int32_t hash[2], __m128d x, __m128d y, __m128d z) {
+	const __m128i h = _mm_and_si128(_mm_setr_epi32(hash[0], hash[1], 0, 0), _mm_set1_epi32(15));
+
+	// widen the 32 bit lane masks to the 64 bit lanes of the doubles
+	const __m128d below8 = _mm_castsi128_pd(_mm_cvtepi32_epi64(_mm_cmplt_epi32(h, _mm_set1_epi32(8))));
+	const __m128d below4 = _mm_castsi128_pd(_mm_cvtepi32_epi64(_mm_cmplt_epi32(h, _mm_set1_epi32(4))));
+	const __m128d xz = _mm_castsi128_pd(_mm_cvtepi32_epi64(_mm_or_si128(_mm_cmpeq_epi32(h, _mm_set1_epi32(12)), _mm_cmpeq_epi32(h, _mm_set1_epi32(14)))));
+
+	const __m128d u = _mm_blendv_pd(y, x, below8);
+	const __m128d v = _mm_blendv_pd(_mm_blendv_pd(z, x, xz), y, below4);
+
+	// negation is exact, so flipping the sign bit is the same as the scalar `-u`
+	const __m128d su = _mm_castsi128_pd(_mm_slli_epi64(_mm_cvtepi32_epi64(_mm_and_si128(h, _mm_set1_epi32(1))), 63));
+	const __m128d sv = _mm_castsi128_pd(_mm_slli_epi64(_mm_cvtepi32_epi64(_mm_and_si128(h, _mm_set1_epi32(2))), 62));
+
+	return _mm_add_pd(_mm_xor_pd(u, su), _mm_xor_pd(v, sv));
+}
+
+TARGET_SSE4 static __m128d sampleSSE4(const int32_t* p, __m128d x, __m128d y, __m128d z) {
+	const __m128d fx = _mm_floor_pd(x);
+	const __m128d fy = _mm_floor_pd(y);
+	const __m128d fz = _mm_floor_pd(z);
+
+	alignas(16) int32_t ix[4], iy[4], iz[4];
+	_mm_store_si128((__m128i*) ix, _mm_cvttpd_epi32(fx));
+	_mm_store_si128((__m128i*) iy, _mm_cvttpd_epi32(fy));
+	_mm_store_si128((__m128i*) iz, _mm_cvttpd_epi32(fz));
+
+	int32_t hashes[8][2];
+
+	for (int lane = 0; lane < 2; lane ++) {
+		const int32_t a = (p[ix[lane] & 255] + (iy[lane] & 255)) & 255;
+		const int32_t b = (p[(ix[lane] + 1) & 255] + (iy[lane] & 255)) & 255;
+		const int32_t aa = (p[a] + (iz[lane] & 255)) & 255;
+		const int32_t ab = (p[(a + 1) & 255] + (iz[lane] & 255)) & 255;
+		const int32_t ba = (p[b] + (iz[lane] & 255)) & 255;
+		const int32_t bb = (p[(b + 1) & 255] + (iz[lane] & 255)) & 255;
+
+		hashes[0][lane] = p[aa];
+		hashes[1][lane] = p[ba];
+		hashes[2][lane] = p[ab];
+		hashes[3][lane] = p[bb];
+		hashes[4][lane] = p[(aa + 1) & 255];
+		hashes[5][lane] = p[(ba + 1) & 255];
+		hashes[6][lane] = p[(ab + 1) & 255];
+		hashes[7][lane] = p[(bb + 1) & 255];
+	}
+
+	x = _mm_sub_pd(x, fx);
+	y = _mm_sub_pd(y, fy);
+	z = _mm_sub_pd(z, fz);
+
+	const __m128d one = _mm_set1_pd(1);
+	const __m128d x1 = _mm_sub_pd(x, one);
+	const __m128d y1 = _mm_sub_pd(y, one);
+	const __m128d z1 = _mm_sub_pd(z, one);
+
+	const __m128d u = fadeSSE4(x);
+	const __m128d v = fadeSSE4(y);
+	const __m128d w = fadeSSE4(z);
+
+	const __m128d q0 = lerpSSE4(gradSSE4(hashes[0], x, y, z), gradSSE4(hashes[1], x1, y, z), u);
+	const __m128d q1 = lerpSSE4(gradSSE4(hashes[2], x, y1, z), gradSSE4(hashes[3], x1, y1, z), u);
+	const __m128d q2 = lerpSSE4(gradSSE4(hashes[4], x, y, z1), gradSSE4(hashes[5], x1, y, z1), u);
+	const __m128d q3 = lerpSSE4(gradSSE4(hashes[6], x, y1, z1), gradSSE4(hashes[7], x1, y1, z1), u);
+
+	return lerpSSE4(lerpSSE4(q0, q1, v), lerpSSE4(q2, q3, v), w);
+}
+
+TARGET_SSE4 static size_t evaluateSSE4(const int32_t* p, const NoiseBatch& batch) {
+	const size_t count = batch.count & ~size_t {1};
+	const __m128d two = _mm_set1_pd(2);
+	const __m128d depth = _mm_set1_pd(batch.z ? 2 : 1);
+
+	for (size_t i = 0; i < count; i += 2) {
+		__m128d x = _mm_loadu_pd(batch.x + i);
+		__m128d y = _mm_loadu_pd(batch.y + i);
+		__m128d z = batch.z ? _mm_loadu_pd(batch.z + i) : _mm_set1_pd(default_z);
+		__m128d result = _mm_setzero_pd();
+		double amplitude = 1;
+
+		for (int octave = 0; octave < batch.octaves; octave ++) {
+			result = _mm_add_pd(result, _mm_mul_pd(sampleSSE4(p, x, y, z), _mm_set1_pd(amplitude)));
+			x = _mm_mul_pd(x, two);
+			y = _mm_mul_pd(y, two);
+			z = _mm_mul_pd(z, depth);
+			amplitude *= batch.persistence;
+		}
+
+		if (batch.remap) {
+			const __m128d low = _mm_cmple_pd(result, _mm_set1_pd(-1));
+			const __m128d high = _mm_cmpge_pd(result, _mm_set1_pd(1));
+			const __m128d mapped = _mm_add_pd(_mm_mul_pd(result, _mm_set1_pd(0.5)), _mm_set1_pd(0.5));
+			result = _mm_blendv_pd(_mm_blendv_pd(mapped, _mm_setzero_pd(), low), _mm_set1_pd(1), high);
+		}
+
+		_mm_storeu_pd(batch.out + i, result);
+	}
+
+	return count;
+}
+
+/*
+ * AVX2
+ */
+
+// the same steps as the scalar code, four points at a time, with the permutation lookups done using gathers
+TARGET_AVX2 static __m256d fadeAVX2(__m256d t) {
+	const __m256d cube = _mm256_mul_pd(_mm256_mul_pd(t, t), t);
+	return _mm256_mul_pd(cube, _mm256_add_pd(_mm256_mul_pd(t, _mm256_sub_pd(_mm256_mul_pd(t, _mm256_set1_pd(6)), _mm256_set1_pd(15))), _mm256_set1_pd(10)));
+}
+
+TARGET_AVX2 static __m256d lerpAVX2(__m256d a, __m256d b, __m256d t) {
+	return _mm256_add_pd(a, _mm256_mul_pd(_mm256_sub_pd(b, a), t));
+}
+
+TARGET_AVX2 static __m256d gradAVX2(__m128i hash, __m256d x, __m256d y, __m256d z) {
+	const __m128i h = _mm_and_si128(hash, _mm_set1_epi32(15));
+
+	// widen the 32 bit lane masks to the 64 bit lanes of the doubles
+	const __m256d below8 = _mm256_castsi256_pd(_mm256_cvtepi32_epi64(_mm_cmplt_epi32(h, _mm_set1_epi32(8))));
+	const __m256d below4 = _mm256_castsi256_pd(_mm256_cvtepi32_epi64(_mm_cmplt_epi32(h, _mm_set1_epi32(4))));
+	const __m256d xz = _mm256_castsi256_pd(_mm256_cvtepi32_epi64(_mm_or_si128(_mm_cmpeq_epi32(h, _mm_set1_epi32(12)), _mm_cmpeq_epi32(h, _mm_set1_epi32(14)))));
+
+	const __m256d u = _mm256_blendv_pd(y, x, below8);
+	const __m256d v = _mm256_blendv_pd(_mm256_blendv_pd(z, x, xz), y, below4);
+
+	const __m256d su = _mm256_castsi256_pd(_mm256_slli_epi64(_mm256_cvtepi32_epi64(_mm_and_si128(h, _mm_set1_epi32(1))), 63));
+	const __m256d sv = _mm256_castsi256_pd(_mm256_slli_epi64(_mm256_cvtepi32_epi64(_mm_and_si128(h, _mm_set1_epi32(2))), 62));
+
+	return _mm256_add_pd(_mm256_xor_pd(u, su), _mm256_xor_pd(v, sv));
+}
+
+TARGET_AVX2 static __m128i lookupAVX2(const int32_t* p, __m128i index) {
+	return _mm_i32gather_epi32(p, index, 4);
+}
+
+TARGET_AVX2 static __m128i nextAVX2(__m128i index) {
+	return _mm_and_si128(_mm_add_epi32(index, _mm_set1_epi32(1)), _mm_set1_epi32(255));
+}
+
+TARGET_AVX2 static __m256d sampleAVX2(const int32_t* p, __m256d x, __m256d y, __m256d z) {
+	const __m256d fx = _mm256_floor_pd(x);
+	const __m256d fy = _mm256_floor_pd(y);
+	const __m256d fz = _mm256_floor_pd(z);
+
+	const __m128i mask = _mm_set1_epi32(255);
+
+	const __m128i ix = _mm_and_si128(_mm256_cvttpd_epi32(fx), mask);
+	const __m128i iy = _mm_and_si128(_mm256_cvttpd_epi32(fy), mask);
+	const __m128i iz = _mm_and_si128(_mm256_cvttpd_epi32(fz), mask);
+
+	const __m128i a = _mm_and_si128(_mm_add_epi32(lookupAVX2(p, ix), iy), mask);
+	const __m128i b = _mm_and_si128(_mm_add_epi32(lookupAVX2(p, nextAVX2(ix)), iy), mask);
+	const __m128i aa = _mm_and_si128(_mm_add_epi32(lookupAVX2(p, a), iz), mask);
+	const __m128i ab = _mm_and_si128(_mm_add_epi32(lookupAVX2(p, nextAVX2(a)), iz), mask);
+	const __m128i ba = _mm_and_si128(_mm_add_epi32(lookupAVX2(p, b), iz), mask);
+	const __m128i bb = _mm_and_si128(_mm_add_epi32(lookupAVX2(p, nextAVX2(b)), iz), mask);
+
+	x = _mm256_sub_pd(x, fx);
+	y = _mm256_sub_pd(y, fy);
+	z = _mm256_sub_pd(z, fz);
+
+	const __m256d unit = _mm256_set1_pd(1);
+	const __m256d x1 = _mm256_sub_pd(x, unit);
+	const __m256d y1 = _mm256_sub_pd(y, unit);
+	const __m256d z1 = _mm256_sub_pd(z, unit);
+
+	const __m256d u = fadeAVX2(x);
+	const __m256d v = fadeAVX2(y);
+	const __m256d w = fadeAVX2(z);
+
+	const __m256d q0 = lerpAVX2(gradAVX2(lookupAVX2(p, aa), x, y, z), gradAVX2(lookupAVX2(p, ba), x1, y, z), u);
+	const __m256d q1 = lerpAVX2(gradAVX2(lookupAVX2(p, ab), x, y1, z), gradAVX2(lookupAVX2(p, bb), x1, y1, z), u);
+	const __m256d q2 = lerpAVX2(gradAVX2(lookupAVX2(p, nextAVX2(aa)), x, y, z1), gradAVX2(lookupAVX2(p, nextAVX2(ba)), x1, y, z1), u);
+	const __m256d q3 = lerpAVX2(gradAVX2(lookupAVX2(p, nextAVX2(ab)), x, y1, z1), gradAVX2(lookupAVX2(p, nextAVX2(bb)), x1, y1, z1), u);
+
+	return lerpAVX2(lerpAVX2(q0, q1, v), lerpAVX2(q2, q3, v), w);
+}
+
+TARGET_AVX2 static size_t evaluateAVX2(const int32_t* p, const NoiseBatch& batch) {
+	const size_t count = batch.count & ~size_t {3};
+	const __m256d two = _mm256_set1_pd(2);
+	const __m256d depth = _mm256_set1_pd(batch.z ? 2 : 1);
+
+	for (size_t i = 0; i < count; i += 4) {
+		__m256d x = _mm256_loadu_pd(batch.x + i);
+		__m256d y = _mm256_loadu_pd(batch.y + i);
+		__m256d z = batch.z ? _mm256_loadu_pd(batch.z + i) : _mm256_set1_pd(default_z);
+		__m256d result = _mm256_setzero_pd();
+		double amplitude = 1;
+
+		for (int octave = 0; octave < batch.octaves; octave ++) {
+			result = _mm256_add_pd(result, _mm256_mul_pd(sampleAVX2(p, x, y, z), _mm256_set1_pd(amplitude)));
+			x = _mm256_mul_pd(x, two);
+			y = _mm256_mul_pd(y, two);
+			z = _mm256_mul_pd(z, depth);
+			amplitude *= batch.persistence;
+		}
+
+		if (batch.remap) {
+			const __m256d low = _mm256_cmp_pd(result, _mm256_set1_pd(-1), _CMP_LE_OQ);
+			const __m256d high = _mm256_cmp_pd(result, _mm256_set1_pd(1), _CMP_GE_OQ);
+			const __m256d mapped = _mm256_add_pd(_mm256_mul_pd(result, _mm256_set1_pd(0.5)), _mm256_set1_pd(0.5));
+			result = _mm256_blendv_pd(_mm256_blendv_pd(mapped, _mm256_setzero_pd(), low), _mm256_set1_pd(1), high);
+		}
+
+		_mm256_storeu_pd(batch.out + i, result);
+	}
+
+	return count;
+}
+
+#endif
+
+static void evaluate(const int32_t* p, BatchNoise::Path path, const NoiseBatch& batch) {
+	size_t done = 0;
+
+#ifdef NOISE_X86
+	if (path == BatchNoise::Path::AVX2) done = evaluateAVX2(p, batch);
+	if (path == BatchNoise::Path::SSE4) done = evaluateSSE4(p, batch);
+#endif
+
+	// the remainder that doesn't fill a whole vector
+	evaluateScalar(p, batch, done);
+}
+
+/*
+ * BatchNoise
+ */
+
+BatchNoise::BatchNoise(const siv::PerlinNoise& noise)
+: path(detect()) {
+	const auto& state = noise.serialize();
+	std::copy(state.begin(), state.end(), permutation);
+}
+
+BatchNoise::Path BatchNoise::detect() {
+#ifdef NOISE_X86
+	if (__builtin_cpu_supports("avx2")) return Path::AVX2;
+	if (__builtin_cpu_supports("sse4.1")) return Path::SSE4;
+#endif
+
+	return Path::SCALAR;
+}
+
+void BatchNoise::setPath(Path path) {
+	this->path = std::min(path, detect());
+}
+
+BatchNoise::Path BatchNoise::getPath() const {
+	return path;
+}
+
+void BatchNoise::noise3D(std::span<const double> x, std::span<const double> y, std::span<const double> z, std::span<double> out) const {
+	evaluate(permutation, path, {x.data(), y.data(), z.data(), out.data(), out.size(), 1, 1, false});
+}
+
+void BatchNoise::noise3D_01(std::span<const double> x, std::span<const double> y, std::span<const double> z, std::span<double> out) const {
+	evaluate(permutation, path, {x.data(), y.data(), z.data(), out.data(), out.size(), 1, 1, true});
+}
+
+void BatchNoise::octave2D_01(std::span<const double> x, std::span<const double> y, std::span<double> out, int octaves, double persistence) const {
+	evaluate(permutation, path, {x.data(), y.data(), nullptr, out.data(), out.size(), octaves, persistence, true});
+}
+
+void BatchNoise::octave3D_01(std::span<const double> x, std::span<const double> y, std::span<const double> z, std::span<double> out, int octaves, double persistence) const {
+	evaluate(permutation, path, {x.data(), y.data(), z.data(), out.data(), out.size(), octaves, persistence, true});
+}
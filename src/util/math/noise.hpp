@@ -0,0 +1,51 @@
+#pragma once
+
+#include "external.hpp"
+
+/**
+ * Evaluates the same Perlin noise as siv::PerlinNoise, but for whole arrays of points at once, using AVX2 or SSE4.1
+ * when the CPU supports them and plain scalar code otherwise. It copies the permutation of the given siv noise and
+ * performs the same double precision operations in the same order, so every path returns the same values as siv.
+ */
+class BatchNoise {
+
+	public:
+
+		/// The instruction sets, ordered from the slowest to the fastest
+		enum struct Path : uint8_t {
+			SCALAR,
+			SSE4,
+			AVX2
+		};
+
+	private:
+
+		// the permutation widened to 32 bits, so that AVX2 can gather from it directly
+		alignas(32) int32_t permutation[256];
+		Path path;
+
+	public:
+
+		/// Copies the permutation of the given noise and selects the fastest path supported by this CPU
+		explicit BatchNoise(const siv::PerlinNoise& noise);
+
+		/// Returns the fastest path supported by this CPU
+		static Path detect();
+
+		/// Selects the given path, or the fastest supported one if this CPU doesn't support it
+		void setPath(Path path);
+
+		/// Returns the currently selected path
+		Path getPath() const;
+
+	public:
+
+		// All the arrays passed to one call must have the same length, the results match
+		// the siv::PerlinNoise functions of the same name called for each point in turn
+
+		void noise3D(std::span<const double> x, std::span<const double> y, std::span<const double> z, std::span<double> out) const;
+		void noise3D_01(std::span<const double> x, std::span<const double> y, std::span<const double> z, std::span<double> out) const;
+		void octave2D_01(std::span<const double> x, std::span<const double> y, std::span<double> out, int octaves, double persistence = 0.5) const;
+		void octave3D_01(std::span<const double> x, std::span<const double> y, std::span<const double> z, std::span<double> out, int octaves, double persistence = 0.5) const;
+
+};
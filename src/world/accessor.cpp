@@ -0,0 +1,51 @@
+
+#include "accessor.hpp"
+#include "world.hpp"
+
+/*
+ * BlockAccessor
+ */
+
+BlockAccessor::BlockAccessor(World& world)
+: world(world), key(0), chunk() {}
+
+Chunk* BlockAccessor::getChunk(int cx, int cy, int cz) {
+	const glm::ivec3 pos {cx, cy, cz};
+
+	if (!chunk || key != pos) {
+		chunk = world.getChunk(cx, cy, cz).lock();
+		key = pos;
+	}
+
+	return chunk.get();
+}
+
+Block BlockAccessor::getBlock(int x, int y, int z) {
+	if (Chunk* chunk = getChunk(x >> Chunk::bits, y >> Chunk::bits, z >> Chunk::bits)) {
+		return chunk->getBlock(x & Chunk::mask, y & Chunk::mask, z & Chunk::mask);
+	}
+
+	throw AccessError {x, y, z};
+}
+
+void BlockAccessor::setBlock(int x, int y, int z, Block block) {
+	if (Chunk* chunk = getChunk(x >> Chunk::bits, y >> Chunk::bits, z >> Chunk::bits)) {
+		int mx = x & Chunk::mask;
+		int my = y & Chunk::mask;
+		int mz = z & Chunk::mask;
+
+		chunk->setBlock(mx, my, mz, block);
+		world.pushBlockUpdate(chunk->pos, mx, my, mz, block);
+		return;
+	}
+
+	throw AccessError {x, y, z};
+}
+
+bool BlockAccessor::isAir(int x, int y, int z) {
+	if (Chunk* chunk = getChunk(x >> Chunk::bits, y >> Chunk::bits, z >> Chunk::bits)) {
+		return !chunk->occupied(x & Chunk::mask, y & Chunk::mask, z & Chunk::mask);
+	}
+
+	throw AccessError {x, y, z};
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "external.hpp"
+#include "block.hpp"
+
+class World;
+class Chunk;
+
+/**
+ * Cached world accessor, remembers the last chunk it resolved and goes back to the
+ * world's chunk map only once the accessed position leaves that chunk. This is meant to
+ * be a short-lived, per-thread object, as it holds a strong reference to the cached chunk
+ * it can keep returning blocks from a chunk that was unloaded in the meantime.
+ */
+class BlockAccessor {
+
+	private:
+
+		World& world;
+		glm::ivec3 key;
+		std::shared_ptr<Chunk> chunk;
+
+	public:
+
+		BlockAccessor(World& world);
+
+		/// Returns the chunk at the specified chunk coordinates
+		/// or nullptr if that chunk is not loaded
+		Chunk* getChunk(int cx, int cy, int cz);
+
+		/// Returns the block at the specified world coordinates,
+		/// if the containing chunk is not loaded throws AccessError
+		Block getBlock(int x, int y, int z);
+
+		/// Sets the block at the specified world coordinates and notifies the world,
+		/// if the containing chunk is not loaded throws AccessError
+		void setBlock(int x, int y, int z, Block block);
+
+		/// Checks if the block at the specified world coordinates is air,
+		/// if the containing chunk is not loaded throws AccessError
+		bool isAir(int x, int y, int z);
+
+};
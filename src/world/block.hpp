@@ -65,4 +65,11 @@ class Block {
 
 };
 
-static_assert(sizeof(Block) == sizeof(Block::packed_type), "Invalid size of the world Block class");
\ No newline at end of file
+static_assert(sizeof(Block) == sizeof(Block::packed_type), "Invalid size of the world Block class");
+
+struct BlockEdit {
+
+	glm::ivec3 pos;
+	Block block;
+
+};
@@ -1,6 +1,113 @@
 
 #include "chunk.hpp"
 
+/*
+ * DirtySlices
+ */
+
+DirtySlices DirtySlices::all() {
+	DirtySlices slices;
+
+	for (auto& level : slices.masks) {
+		std::fill_n(level, 3, ~uint32_t {0});
+	}
+
+	return slices;
+}
+
+void DirtySlices::mark(int x, int y, int z) {
+	const int coordinates[3] = {x, y, z};
+
+	for (int level = 0; level < levels; level ++) {
+		const int step = 1 << level;
+
+		// this block is not sampled at this level
+		if ((x | y | z) & (step - 1)) {
+			continue;
+		}
+
+		for (int axis = 0; axis < 3; axis ++) {
+			const int value = coordinates[axis];
+
+			// this block stands for `step` blocks along each axis, and can
+			// cull the faces of the closest blocks on both sides of that range
+			const int low = std::max(value - 1, 0);
+			const int high = std::min(value + step, (int) Chunk::mask);
+
+			masks[level][axis] |= (~uint32_t {0} >> (Chunk::mask - (high - low))) << low;
+		}
+	}
+}
+
+void DirtySlices::mark(glm::ivec3 from, glm::ivec3 to) {
+	for (int level = 0; level < levels; level ++) {
+		const int step = 1 << level;
+
+		// the first and last sampled positions of the box at this level
+		const glm::ivec3 first = (from + step - 1) & ~(step - 1);
+		const glm::ivec3 last = to & ~(step - 1);
+
+		// no block in this box is sampled at this level
+		if (glm::any(glm::greaterThan(first, last))) {
+			continue;
+		}
+
+		for (int axis = 0; axis < 3; axis ++) {
+
+			// the same range `mark` uses for a single block, spanning the whole box
+			const int low = std::max(first[axis] - 1, 0);
+			const int high = std::min(last[axis] + step, (int) Chunk::mask);
+
+			masks[level][axis] |= (~uint32_t {0} >> (Chunk::mask - (high - low))) << low;
+		}
+	}
+}
+
+void DirtySlices::add(int level, int axis, int slice) {
+	masks[level][axis] |= uint32_t {1} << slice;
+}
+
+bool DirtySlices::contains(int level, int axis, int slice) const {
+	return masks[level][axis] & (uint32_t {1} << slice);
+}
+
+bool DirtySlices::contains(int level, int axis) const {
+	return masks[level][axis] != 0;
+}
+
+bool DirtySlices::empty() const {
+	for (const auto& level : masks) {
+		if (level[0] | level[1] | level[2]) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/*
+ * ChunkSnapshot
+ */
+
+ChunkSnapshot::ChunkSnapshot(glm::ivec3 pos, uint64_t version, std::shared_ptr<const ChunkData> data)
+: data(std::move(data)), pos(pos), version(version) {}
+
+ChunkSnapshot::operator bool() const {
+	return (bool) data;
+}
+
+const ChunkData* ChunkSnapshot::operator ->() const {
+	return data.get();
+}
+
+const ChunkData& ChunkSnapshot::operator *() const {
+	return *data;
+}
+
+/*
+ * Chunk
+ */
+
 Direction Chunk::getNeighboursMask(int x, int y, int z) {
 	Direction::mask_type directions = Direction::NONE;
 
@@ -16,33 +123,357 @@ Direction Chunk::getNeighboursMask(int x, int y, int z) {
 	return directions;
 }
 
-Block& Chunk::ref(int x, int y, int z) {
-	return (*blocks)[x + y * size + z * size * size];
+ChunkData& Chunk::writable() {
+
+	// someone holds a snapshot, we can't modify the data in place
+	if (data.use_count() > 1) {
+		data = std::make_shared<ChunkData>(*data);
+	}
+
+	return *data;
 }
 
-Chunk::Chunk(glm::ivec3 pos)
-: pos(pos) {}
+std::shared_ptr<const ChunkData> Chunk::acquire() const {
+	std::lock_guard lock {mutex};
+	return data;
+}
+
+void Chunk::touch(const DirtySlices& slices) {
+	if (!history) {
+		history = std::make_unique<SliceHistory>();
+		history->base = version;
+	}
 
-Chunk::~Chunk() {
-	std::free(blocks);
+	version ++;
+
+	for (int level = 0; level < DirtySlices::levels; level ++) {
+		for (int axis = 0; axis < 3; axis ++) {
+			for (uint32_t bits = slices.masks[level][axis]; bits != 0; bits &= bits - 1) {
+				history->stamps[level][axis][std::countr_zero(bits)] = version;
+			}
+		}
+	}
 }
 
+Chunk::Chunk(glm::ivec3 pos)
+: data(std::make_shared<ChunkData>()), pos(pos) {}
+
 void Chunk::setBlock(int x, int y, int z, Block block) {
-	if (!blocks) {
-		blocks = (Block (*)[size * size * size]) std::calloc(size * size * size, sizeof(Block));
-	}
+	std::lock_guard lock {mutex};
+
+	writable().setBlock(x, y, z, block);
+	modified = true;
 
-	ref(x, y, z) = block;
+	DirtySlices slices;
+	slices.mark(x, y, z);
+	touch(slices);
 }
 
 Block Chunk::getBlock(int x, int y, int z) {
-	if (!blocks) {
-		return Block {0};
+	return acquire()->getBlock(x, y, z);
+}
+
+void Chunk::fill(Block block) {
+	std::lock_guard lock {mutex};
+
+	writable().fill(block);
+	modified = true;
+	touch(DirtySlices::all());
+}
+
+void Chunk::fill(glm::ivec3 from, glm::ivec3 to, Block block) {
+	std::lock_guard lock {mutex};
+
+	writable().fill(from, to, block);
+	modified = true;
+
+	DirtySlices slices;
+	slices.mark(from, to);
+	touch(slices);
+}
+
+void Chunk::fillColumn(int x, int z, int y, int count, Block block) {
+	if (count <= 0) {
+		return;
 	}
 
-	return ref(x, y, z);
+	std::lock_guard lock {mutex};
+
+	writable().fillColumn(x, z, y, count, block);
+	modified = true;
+
+	DirtySlices slices;
+	slices.mark({x, y, z}, {x, y + count - 1, z});
+	touch(slices);
+}
+
+void Chunk::setRow(int y, int z, const Block* blocks) {
+	std::lock_guard lock {mutex};
+
+	writable().setRow(y, z, blocks);
+	modified = true;
+
+	DirtySlices slices;
+	slices.mark({0, y, z}, {mask, y, z});
+	touch(slices);
+}
+
+void Chunk::compact() {
+	std::lock_guard lock {mutex};
+	writable().compact();
+	history.reset();
 }
 
 bool Chunk::empty() {
-	return blocks == nullptr;
+	return acquire()->empty();
+}
+
+bool Chunk::uniform() {
+	return acquire()->uniform();
+}
+
+bool Chunk::solid() {
+	return acquire()->solid();
+}
+
+bool Chunk::occupied(int x, int y, int z) {
+	return acquire()->occupied(x, y, z);
+}
+
+uint32_t Chunk::getColumnMask(int x, int z) {
+	return acquire()->getColumnMask(x, z);
+}
+
+int Chunk::count() {
+	return acquire()->count();
+}
+
+bool Chunk::empty(glm::ivec3 from, glm::ivec3 to) {
+	return acquire()->empty(from, to);
+}
+
+size_t Chunk::bytes() const {
+	return acquire()->bytes();
+}
+
+size_t Chunk::memory() const {
+	std::lock_guard lock {mutex};
+	return sizeof(Chunk) + sizeof(ChunkData) + data->bytes() + (history ? sizeof(SliceHistory) : 0);
+}
+
+bool Chunk::isModified() const {
+	return modified;
+}
+
+void Chunk::setModified(bool modified) {
+	this->modified = modified;
+}
+
+uint64_t Chunk::getVersion() const {
+	return version;
+}
+
+ChunkSnapshot Chunk::snapshot() {
+	std::lock_guard lock {mutex};
+	return {pos, version, data};
+}
+
+bool Chunk::getChanges(uint64_t since, DirtySlices& slices) {
+	std::lock_guard lock {mutex};
+	slices = {};
+
+	if (since == version) {
+		return true;
+	}
+
+	if (!history || since < history->base) {
+		return false;
+	}
+
+	for (int level = 0; level < DirtySlices::levels; level ++) {
+		for (int axis = 0; axis < 3; axis ++) {
+			for (int slice = 0; slice < size; slice ++) {
+				if (history->stamps[level][axis][slice] > since) {
+					slices.add(level, axis, slice);
+				}
+			}
+		}
+	}
+
+	return true;
+}
+
+/*
+ * ChunkData
+ */
+
+int ChunkData::indexOf(int x, int y, int z) {
+	return x + y * Chunk::size + z * Chunk::size * Chunk::size;
+}
+
+void ChunkData::updateOccupancy(bool solid) {
+	if (blocks.uniform()) {
+		std::free(occupancy);
+		occupancy = nullptr;
+		return;
+	}
+
+	if (!occupancy) {
+		occupancy = (uint32_t*) std::malloc(Chunk::size * Chunk::size * sizeof(uint32_t));
+		std::fill_n(occupancy, Chunk::size * Chunk::size, solid ? ~uint32_t {0} : uint32_t {0});
+	}
+}
+
+void ChunkData::updateColumn(bool solid, int x, int z, uint32_t bits, bool air) {
+	if (!occupancy) {
+		if (blocks.uniform()) {
+			return;
+		}
+
+		updateOccupancy(solid);
+	}
+
+	uint32_t& column = occupancy[x + z * Chunk::size];
+	column = air ? (column & ~bits) : (column | bits);
+}
+
+ChunkData::ChunkData()
+: blocks(Chunk::size * Chunk::size * Chunk::size) {}
+
+ChunkData::ChunkData(const ChunkData& other)
+: blocks(other.blocks) {
+	if (other.occupancy) {
+		occupancy = (uint32_t*) std::malloc(Chunk::size * Chunk::size * sizeof(uint32_t));
+		std::copy_n(other.occupancy, Chunk::size * Chunk::size, occupancy);
+	}
+}
+
+ChunkData::~ChunkData() {
+	std::free(occupancy);
+}
+
+void ChunkData::setBlock(int x, int y, int z, Block block) {
+	// remember the previous content in case we are about to leave the uniform state
+	const bool solid = !occupancy && this->solid();
+
+	blocks.set(indexOf(x, y, z), block);
+	updateColumn(solid, x, z, uint32_t {1} << y, block.isAir());
+}
+
+void ChunkData::fill(glm::ivec3 from, glm::ivec3 to, Block block) {
+	const bool solid = !occupancy && this->solid();
+	const int length = to.x - from.x + 1;
+
+	for (int z = from.z; z <= to.z; z ++) {
+		for (int y = from.y; y <= to.y; y ++) {
+			blocks.set(indexOf(from.x, y, z), length, 1, block);
+		}
+	}
+
+	const uint32_t bits = (~uint32_t {0} >> (Chunk::mask - (to.y - from.y))) << from.y;
+
+	for (int z = from.z; z <= to.z; z ++) {
+		for (int x = from.x; x <= to.x; x ++) {
+			updateColumn(solid, x, z, bits, block.isAir());
+		}
+	}
+}
+
+void ChunkData::fillColumn(int x, int z, int y, int count, Block block) {
+	if (count <= 0) {
+		return;
+	}
+
+	const bool solid = !occupancy && this->solid();
+
+	blocks.set(indexOf(x, y, z), count, Chunk::size, block);
+	updateColumn(solid, x, z, (~uint32_t {0} >> (Chunk::size - count)) << y, block.isAir());
+}
+
+void ChunkData::setRow(int y, int z, const Block* blocks) {
+	const bool solid = !occupancy && this->solid();
+
+	this->blocks.set(indexOf(0, y, z), blocks, Chunk::size);
+
+	for (int x = 0; x < Chunk::size; x ++) {
+		updateColumn(solid, x, z, uint32_t {1} << y, blocks[x].isAir());
+	}
+}
+
+Block ChunkData::getBlock(int x, int y, int z) const {
+	return blocks.get(indexOf(x, y, z));
+}
+
+void ChunkData::fill(Block block) {
+	blocks.fill(block);
+	updateOccupancy(false);
+}
+
+void ChunkData::compact() {
+	blocks.compact();
+	updateOccupancy(false);
+}
+
+bool ChunkData::empty() const {
+	return blocks.uniform() && blocks.get(0).isAir();
+}
+
+bool ChunkData::uniform() const {
+	return blocks.uniform();
+}
+
+bool ChunkData::solid() const {
+	return blocks.uniform() && !blocks.get(0).isAir();
+}
+
+bool ChunkData::occupied(int x, int y, int z) const {
+	return getColumnMask(x, z) & (uint32_t {1} << y);
+}
+
+uint32_t ChunkData::getColumnMask(int x, int z) const {
+	if (!occupancy) {
+		return solid() ? ~uint32_t {0} : uint32_t {0};
+	}
+
+	return occupancy[x + z * Chunk::size];
+}
+
+int ChunkData::count() const {
+	if (!occupancy) {
+		return solid() ? Chunk::size * Chunk::size * Chunk::size : 0;
+	}
+
+	int total = 0;
+
+	for (int i = 0; i < Chunk::size * Chunk::size; i ++) {
+		total += std::popcount(occupancy[i]);
+	}
+
+	return total;
+}
+
+bool ChunkData::empty(glm::ivec3 from, glm::ivec3 to) const {
+	if (!occupancy) {
+		return !solid();
+	}
+
+	// bits from.y to to.y inclusive, shifting by 32 would be undefined hence the two steps
+	const uint32_t bits = (~uint32_t {0} >> (Chunk::mask - (to.y - from.y))) << from.y;
+	uint32_t combined = 0;
+
+	for (int z = from.z; z <= to.z; z ++) {
+		for (int x = from.x; x <= to.x; x ++) {
+			combined |= occupancy[x + z * Chunk::size];
+		}
+	}
+
+	return (combined & bits) == 0;
+}
+
+const std::vector<Block>& ChunkData::getPalette() const {
+	return blocks.entries();
+}
+
+size_t ChunkData::bytes() const {
+	return blocks.bytes() + (occupancy ? Chunk::size * Chunk::size * sizeof(uint32_t) : 0);
 }
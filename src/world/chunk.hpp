@@ -3,7 +3,78 @@
 #include "external.hpp"
 #include "util/type/direction.hpp"
 #include "block.hpp"
+#include "palette.hpp"
 
+class ChunkData;
+
+/**
+ * Set of chunk slices (the planes perpendicular to each of the axes) whose block faces could have
+ * changed, used to limit the work needed to remesh a chunk after an edit. Tracked separately for
+ * each of the mesh detail levels, at level N the mesh samples only every 2^N-th block along each axis.
+ */
+struct DirtySlices {
+
+	static constexpr int levels = 2;
+
+	// one mask per level and axis (indexed by DirectionIndex::X/Y/Z), bit N is set if the slice at N is dirty
+	uint32_t masks[levels][3] {};
+
+	/// Returns a set with all the slices marked
+	static DirtySlices all();
+
+	/// Marks the slices with faces that depend on the block at the given chunk position
+	void mark(int x, int y, int z);
+
+	/// Marks the slices with faces that depend on any block in the given box (with both corners inclusive)
+	void mark(glm::ivec3 from, glm::ivec3 to);
+
+	/// Marks a single slice at the given level
+	void add(int level, int axis, int slice);
+
+	/// Checks if the given slice is marked at the given level
+	bool contains(int level, int axis, int slice) const;
+
+	/// Checks if any slice along the given axis is marked at the given level
+	bool contains(int level, int axis) const;
+
+	/// Checks if no slice is marked at any level
+	bool empty() const;
+
+};
+
+/**
+ * Immutable copy of the chunk content at some version, snapshots share the
+ * data with the chunk until the chunk is next written to, so taking one is cheap
+ */
+class ChunkSnapshot {
+
+	private:
+
+		std::shared_ptr<const ChunkData> data;
+
+	public:
+
+		READONLY glm::ivec3 pos {0};
+		READONLY uint64_t version = 0;
+
+		ChunkSnapshot() = default;
+		ChunkSnapshot(glm::ivec3 pos, uint64_t version, std::shared_ptr<const ChunkData> data);
+
+		/// Checks if this snapshot holds any data
+		explicit operator bool() const;
+
+		/// Access the content of the snapshot
+		const ChunkData* operator ->() const;
+		const ChunkData& operator *() const;
+
+};
+
+/**
+ * A chunk of the world, the blocks themselves are stored in a copy-on-write ChunkData object,
+ * all writes are expected to come from a single thread, other threads can read the chunk directly
+ * (every read briefly holds the data like a snapshot would) or through a snapshot - the snapshot
+ * data is never modified, a write copies it first if it's still in use.
+ */
 class Chunk {
 
 	public:
@@ -18,16 +89,41 @@ class Chunk {
 
 	private:
 
-		Block (*blocks)[size * size * size] = nullptr;
+		// guards the data pointer when taking snapshots
+		// and when replacing the data before a write
+		mutable std::mutex mutex;
+		std::shared_ptr<ChunkData> data;
+
+		// incremented by every write
+		std::atomic<uint64_t> version {0};
+
+		// the version at which each slice was last written to, lets the mesher find out what
+		// changed since the version it last saw, allocated on the first write after a compact
+		struct SliceHistory {
+			uint64_t base;
+			uint64_t stamps[DirtySlices::levels][3][size];
+		};
+
+		std::unique_ptr<SliceHistory> history;
+
+		// set when the content differs from the stored copy (if any), new chunks start modified,
+		// cleared by the generator for its output and by the storage writer thread once written
+		std::atomic<bool> modified {true};
+
+		/// Returns the data for writing, copies it if any snapshot uses it, requires the mutex to be held
+		ChunkData& writable();
+
+		/// Returns the current data, while the pointer is held writes copy the data instead of changing it
+		std::shared_ptr<const ChunkData> acquire() const;
 
-		Block& ref(int x, int y, int z);
+		/// Increments the version and records it for the given slices, requires the mutex to be held
+		void touch(const DirtySlices& slices);
 
 	public:
 
 		READONLY glm::ivec3 pos;
 
 		Chunk(glm::ivec3 pos);
-		~Chunk();
 
 		/// Sets a block at the given chunk position
 		void setBlock(int x, int y, int z, Block block);
@@ -35,7 +131,145 @@ class Chunk {
 		/// Gets the block at the given chunk position
 		Block getBlock(int x, int y, int z);
 
+		/// Sets all blocks in this chunk to the given block, leaves the chunk uniform
+		void fill(Block block);
+
+		/// Sets all blocks in the given box (with both corners inclusive) to the given block
+		void fill(glm::ivec3 from, glm::ivec3 to, Block block);
+
+		/// Sets `count` blocks of the vertical column at x, z, starting at y and going up, to the given block, does nothing if `count` is not positive
+		void fillColumn(int x, int z, int y, int count, Block block);
+
+		/// Sets the whole row (along the X axis) at y, z to the Chunk::size blocks from the given buffer
+		void setRow(int y, int z, const Block* blocks);
+
+		/// Tries to shrink the block storage, chunks that end up
+		/// containing only one block type will become uniform
+		void compact();
+
 		/// Checks if this chunks contains no blocks in O(1) time
 		bool empty();
 
+		/// Checks if this chunks contains only one block type in O(1) time
+		bool uniform();
+
+		/// Checks if this chunks is uniformly filled with a non-air block in O(1) time
+		bool solid();
+
+		/// Checks if there is a non-air block at the given chunk position
+		bool occupied(int x, int y, int z);
+
+		/// Returns the occupancy mask of the given vertical column, bit N is set if the block at y=N is not air
+		uint32_t getColumnMask(int x, int z);
+
+		/// Returns the number of non-air blocks in this chunk
+		int count();
+
+		/// Checks if the given box (with both corners inclusive) contains only air
+		bool empty(glm::ivec3 from, glm::ivec3 to);
+
+		/// Returns the number of heap bytes used to store the blocks of this chunk
+		size_t bytes() const;
+
+		/// Returns the total number of bytes used by this chunk, that is the object itself, the blocks and the slice history
+		size_t memory() const;
+
+		/// Checks if this chunk was changed since it was last loaded or saved
+		bool isModified() const;
+
+		/// Marks this chunk as (un)modified, set automatically by every block write
+		void setModified(bool modified);
+
+		/// Returns the current version of this chunk, it's incremented by every write
+		uint64_t getVersion() const;
+
+		/// Returns an immutable snapshot of the current content, safe to use from any thread
+		ChunkSnapshot snapshot();
+
+		/// Finds the slices written to after the given version, returns false if that version
+		/// is too old to tell (the history is dropped by compact), in that case treat everything as dirty
+		bool getChanges(uint64_t since, DirtySlices& slices);
+
+};
+
+/**
+ * The content of a chunk, the palette compressed blocks and the
+ * occupancy mask, shared between a chunk and its snapshots
+ */
+class ChunkData {
+
+	private:
+
+		BlockPalette blocks;
+
+		// one bit per block, set for non-air blocks, each
+		// element is a vertical column (bit N is at y=N) indexed by x and z,
+		// only allocated when the chunk is not uniform
+		uint32_t* occupancy = nullptr;
+
+		static int indexOf(int x, int y, int z);
+
+		/// Updates the occupancy mask to match the uniform/non-uniform state of the block storage
+		void updateOccupancy(bool solid);
+
+		/// Sets or clears the given bits of the occupancy mask of a column, call after a write
+		/// given the state from before it, does nothing if the block storage is still uniform
+		void updateColumn(bool solid, int x, int z, uint32_t bits, bool air);
+
+	public:
+
+		ChunkData();
+		ChunkData(const ChunkData& other);
+		~ChunkData();
+
+		ChunkData& operator =(const ChunkData& other) = delete;
+
+		/// Sets a block at the given chunk position
+		void setBlock(int x, int y, int z, Block block);
+
+		/// Gets the block at the given chunk position
+		Block getBlock(int x, int y, int z) const;
+
+		/// Sets all blocks to the given block, leaves the data uniform
+		void fill(Block block);
+
+		/// Sets all blocks in the given box (with both corners inclusive) to the given block
+		void fill(glm::ivec3 from, glm::ivec3 to, Block block);
+
+		/// Sets `count` blocks of the vertical column at x, z, starting at y and going up, to the given block, does nothing if `count` is not positive
+		void fillColumn(int x, int z, int y, int count, Block block);
+
+		/// Sets the whole row (along the X axis) at y, z to the Chunk::size blocks from the given buffer
+		void setRow(int y, int z, const Block* blocks);
+
+		/// Tries to shrink the block storage
+		void compact();
+
+		/// Checks if this contains no blocks in O(1) time
+		bool empty() const;
+
+		/// Checks if this contains only one block type in O(1) time
+		bool uniform() const;
+
+		/// Checks if this is uniformly filled with a non-air block in O(1) time
+		bool solid() const;
+
+		/// Checks if there is a non-air block at the given chunk position
+		bool occupied(int x, int y, int z) const;
+
+		/// Returns the occupancy mask of the given vertical column, bit N is set if the block at y=N is not air
+		uint32_t getColumnMask(int x, int z) const;
+
+		/// Returns the number of non-air blocks
+		int count() const;
+
+		/// Checks if the given box (with both corners inclusive) contains only air
+		bool empty(glm::ivec3 from, glm::ivec3 to) const;
+
+		/// Returns the distinct blocks used here, this can include blocks that are no longer present
+		const std::vector<Block>& getPalette() const;
+
+		/// Returns the number of heap bytes used to store the blocks
+		size_t bytes() const;
+
 };
@@ -1,6 +1,65 @@
 
 #include "column.hpp"
 
+int ChunkColumn::findHeight(int x, int z, int below) const {
+	const int top = below >> Chunk::bits;
+
+	for (int cy = std::min(top, max_loaded_chunk); cy >= min_loaded_chunk; cy --) {
+		auto it = chunks.find(cy);
+
+		if (it == chunks.end()) {
+			continue;
+		}
+
+		uint32_t mask = it->second->getColumnMask(x, z);
+
+		// only the blocks under `below` count in its own chunk
+		if (cy == top) {
+			mask &= (uint32_t {1} << (below & Chunk::mask)) - 1;
+		}
+
+		if (mask) {
+			return cy * Chunk::size + Chunk::mask - std::countl_zero(mask);
+		}
+	}
+
+	return no_height;
+}
+
+void ChunkColumn::recomputeHeights() {
+	std::vector<std::pair<int, Chunk*>> sorted;
+	sorted.reserve(chunks.size());
+
+	for (auto& [cy, chunk] : chunks) {
+		if (!chunk->empty()) {
+			sorted.emplace_back(cy, chunk.get());
+		}
+	}
+
+	// highest chunks first, so that we can stop at the first non-air block
+	std::sort(sorted.begin(), sorted.end(), [] (const auto& a, const auto& b) {
+		return a.first > b.first;
+	});
+
+	for (int z = 0; z < Chunk::size; z ++) {
+		for (int x = 0; x < Chunk::size; x ++) {
+			int16_t& height = heights[x + z * Chunk::size];
+			height = no_height;
+
+			for (auto [cy, chunk] : sorted) {
+				if (uint32_t mask = chunk->getColumnMask(x, z)) {
+					height = cy * Chunk::size + Chunk::mask - std::countl_zero(mask);
+					break;
+				}
+			}
+		}
+	}
+}
+
+ChunkColumn::ChunkColumn() {
+	std::fill_n(heights, Chunk::size * Chunk::size, no_height);
+}
+
 std::weak_ptr<Chunk> ChunkColumn::get(int cy) {
 	auto it = chunks.find(cy);
 
@@ -14,6 +73,7 @@ std::weak_ptr<Chunk> ChunkColumn::get(int cy) {
 void ChunkColumn::emplace(Chunk* chunk) {
 	bool first = empty();
 	int key = chunk->pos.y;
+	bool replaced = chunks.contains(key);
 	chunks[key].reset(chunk);
 
 	if (first || key > max_loaded_chunk) {
@@ -23,13 +83,48 @@ void ChunkColumn::emplace(Chunk* chunk) {
 	if (first || key < min_loaded_chunk) {
 		min_loaded_chunk = key;
 	}
+
+	// the replaced chunk could have been the one defining some heights
+	if (replaced) {
+		recomputeHeights();
+		return;
+	}
+
+	if (chunk->empty()) {
+		return;
+	}
+
+	for (int z = 0; z < Chunk::size; z ++) {
+		for (int x = 0; x < Chunk::size; x ++) {
+			if (uint32_t mask = chunk->getColumnMask(x, z)) {
+				int16_t& height = heights[x + z * Chunk::size];
+				height = std::max<int>(height, key * Chunk::size + Chunk::mask - std::countl_zero(mask));
+			}
+		}
+	}
 }
 
 bool ChunkColumn::empty() const {
 	return chunks.empty();
 }
 
-void ChunkColumn::update(int max_distance, int camera_y) {
+size_t ChunkColumn::size() const {
+	return chunks.size();
+}
+
+size_t ChunkColumn::memory() const {
+
+	// this doesn't include the map buckets, but those are small compared to the rest
+	size_t total = sizeof(ChunkColumn) + chunks.values().capacity() * sizeof(decltype(chunks)::value_type);
+
+	for (auto& [cy, chunk] : chunks) {
+		total += chunk->memory();
+	}
+
+	return total;
+}
+
+void ChunkColumn::update(int max_distance, int camera_y, std::vector<std::shared_ptr<Chunk>>& evicted) {
 	int lower = std::abs(min_loaded_chunk - camera_y);
 	int upper = std::abs(max_loaded_chunk - camera_y);
 
@@ -41,9 +136,11 @@ void ChunkColumn::update(int max_distance, int camera_y) {
 		// we will search for the new max and min chunk
 		int min = chunks.values()[0].first;
 		int max = min;
+		size_t count = evicted.size();
 
 		for (auto it = chunks.begin(); it != chunks.end();) {
 			if (std::abs(it->first - camera_y) >= max_distance) {
+				evicted.push_back(std::move(it->second));
 				it = chunks.erase(it);
 				continue;
 			}
@@ -56,6 +153,10 @@ void ChunkColumn::update(int max_distance, int camera_y) {
 
 		max_loaded_chunk = max;
 		min_loaded_chunk = min;
+
+		if (evicted.size() != count) {
+			recomputeHeights();
+		}
 	}
 }
 
@@ -64,4 +165,22 @@ bool ChunkColumn::contains(int cy) const {
 	if (cy < min_loaded_chunk) return false;
 
 	return chunks.contains(cy);
+}
+
+int ChunkColumn::getHeight(int x, int z) const {
+	return heights[x + z * Chunk::size];
+}
+
+void ChunkColumn::updateHeight(int x, int z, int low, int high, bool air) {
+	int16_t& height = heights[x + z * Chunk::size];
+
+	if (!air) {
+		height = std::max(height, (int16_t) high);
+		return;
+	}
+
+	// the highest block was removed, look for the next one below
+	if (height >= low && height <= high) {
+		height = findHeight(x, z, low);
+	}
 }
\ No newline at end of file
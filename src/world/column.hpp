@@ -5,6 +5,11 @@
 
 class ChunkColumn {
 
+	public:
+
+		/// The height of a position with no loaded non-air blocks
+		static constexpr int16_t no_height = std::numeric_limits<int16_t>::min();
+
 	private:
 
 		int max_loaded_chunk = 0;
@@ -12,8 +17,19 @@ class ChunkColumn {
 
 		ankerl::unordered_dense::map<int, std::shared_ptr<Chunk>> chunks;
 
+		// the world Y of the highest loaded non-air block at each x, z (indexed by x + z * Chunk::size)
+		int16_t heights[Chunk::size * Chunk::size];
+
+		/// Returns the world Y of the highest loaded non-air block below the given world Y, or no_height
+		int findHeight(int x, int z, int below) const;
+
+		/// Computes the whole heightmap from scratch, used when a chunk is removed or replaced
+		void recomputeHeights();
+
 	public:
 
+		ChunkColumn();
+
 		/// Get chunk or nullptr, requires external synchronization
 		std::weak_ptr<Chunk> get(int cy);
 
@@ -23,10 +39,31 @@ class ChunkColumn {
 		/// Check if the column contains no chunks
 		bool empty() const;
 
-		/// Remove chunks outside the given max_distance
-		void update(int max_distance, int camera_y);
+		/// Returns the number of chunks in this column
+		size_t size() const;
+
+		/// Returns the total number of bytes used by this column and its chunks, requires external synchronization
+		size_t memory() const;
+
+		/// Remove chunks outside the given max_distance, removed chunks are appended to `evicted`
+		void update(int max_distance, int camera_y, std::vector<std::shared_ptr<Chunk>>& evicted);
 
 		/// Check if the column contains chunk with given y
 		bool contains(int cy) const;
 
+		/// Returns the world Y of the highest loaded non-air block at the given chunk-local x, z, or no_height
+		int getHeight(int x, int z) const;
+
+		/// Updates the heightmap after all blocks in the given world Y range (inclusive)
+		/// at the given chunk-local x, z were set to air or to some non-air block
+		void updateHeight(int x, int z, int low, int high, bool air);
+
+		/// Calls the given function for every chunk in this column, requires external synchronization
+		template <typename Func>
+		void forEach(Func func) {
+			for (auto& [cy, chunk] : chunks) {
+				func(chunk);
+			}
+		}
+
 };
@@ -0,0 +1,255 @@
+
+#include "fluid.hpp"
+#include "world.hpp"
+#include "util/thread/pool.hpp"
+
+// the four horizontal neighbours, fluid spreads only along these
+static constexpr glm::ivec3 horizontal[4] = {{-1, 0, 0}, {+1, 0, 0}, {0, 0, -1}, {0, 0, +1}};
+
+// the cells whose next state depends on the cell at the origin, that is the cell itself, the one below (it can be falling from
+// the origin), the horizontal neighbours (the origin can spread into them) and the ones above those (the origin can support them)
+static constexpr glm::ivec3 dependants[10] = {
+	{0, 0, 0}, {0, -1, 0},
+	{-1, 0, 0}, {+1, 0, 0}, {0, 0, -1}, {0, 0, +1},
+	{-1, 1, 0}, {+1, 1, 0}, {0, 1, -1}, {0, 1, +1}
+};
+
+// unloaded chunks are treated as solid, so fluid can't flow into them
+static const Block unloaded {~Block::packed_type {0}};
+
+/// Returns the chunk local index of the given world (or chunk relative) position
+static uint16_t indexOf(glm::ivec3 pos) {
+	return (pos.x & Chunk::mask) | ((pos.y & Chunk::mask) << Chunk::bits) | ((pos.z & Chunk::mask) << (2 * Chunk::bits));
+}
+
+static Block readBlock(const ChunkData* const around[27], glm::ivec3 pos) {
+	const int cx = (pos.x >> Chunk::bits) + 1;
+	const int cy = (pos.y >> Chunk::bits) + 1;
+	const int cz = (pos.z >> Chunk::bits) + 1;
+
+	if (const ChunkData* data = around[cx + cy * 3 + cz * 9]) {
+		return data->getBlock(pos.x & Chunk::mask, pos.y & Chunk::mask, pos.z & Chunk::mask);
+	}
+
+	return unloaded;
+}
+
+/*
+ * FluidSimulator
+ */
+
+Block FluidSimulator::fluid(uint8_t type, uint8_t amount) {
+	Block block {0};
+
+	if (amount > 0) {
+		block.fluid_type = type;
+		block.fluid_amount = amount;
+	}
+
+	return block;
+}
+
+bool FluidSimulator::isFluid(Block block) {
+	return block.block_type == 0 && block.fluid_amount > 0;
+}
+
+void FluidSimulator::ActiveCells::add(uint16_t index) {
+	uint64_t& word = marked[index / 64];
+	const uint64_t bit = uint64_t {1} << (index % 64);
+
+	if (!(word & bit)) {
+		word |= bit;
+		indices.push_back(index);
+	}
+}
+
+Block FluidSimulator::evaluate(const ChunkData* const around[27], glm::ivec3 pos) {
+	Block block = readBlock(around, pos);
+
+	// solid blocks and sources are never changed by the simulation
+	if (block.block_type != 0 || block.fluid_amount == source) {
+		return block;
+	}
+
+	Block above = readBlock(around, pos + glm::ivec3 {0, 1, 0});
+
+	if (isFluid(above)) {
+		return fluid(above.fluid_type, falling);
+	}
+
+	uint8_t type = 0;
+	uint8_t amount = 0;
+
+	for (glm::ivec3 offset : horizontal) {
+		Block side = readBlock(around, pos + offset);
+
+		if (!isFluid(side) || side.fluid_amount <= amount + 1) {
+			continue;
+		}
+
+		// fluid with nothing below it falls down instead of spreading sideways
+		Block below = readBlock(around, pos + offset + glm::ivec3 {0, -1, 0});
+
+		if (below.block_type == 0 && !isFluid(below)) {
+			continue;
+		}
+
+		type = side.fluid_type;
+		amount = side.fluid_amount - 1;
+	}
+
+	return fluid(type, amount);
+}
+
+void FluidSimulator::insert(ActiveSet& set, const std::vector<glm::ivec3>& positions, std::span<const glm::ivec3> offsets) {
+
+	// most of the cells are in the same chunk as the previous one, so remember it
+	ActiveCells* cells = nullptr;
+	glm::ivec3 last {0};
+
+	for (glm::ivec3 pos : positions) {
+		for (glm::ivec3 offset : offsets) {
+			glm::ivec3 target = pos + offset;
+			glm::ivec3 key {target.x >> Chunk::bits, target.y >> Chunk::bits, target.z >> Chunk::bits};
+
+			if (!cells || key != last) {
+				cells = &set[key];
+				last = key;
+			}
+
+			cells->add(indexOf(target));
+		}
+	}
+}
+
+void FluidSimulator::activate(glm::ivec3 pos) {
+	std::lock_guard lock {mutex};
+	edits.push_back(pos);
+}
+
+void FluidSimulator::tick(World& world, TaskPool& pool, std::vector<BlockEdit>& changes) {
+
+	struct Job {
+		glm::ivec3 key;
+		std::shared_ptr<Chunk> chunk;
+		std::vector<uint16_t> cells;
+		const ChunkData* around[27];
+
+		// results, the cells activated within this chunk and the ones handed off to the neighbours
+		std::vector<BlockEdit> changes;
+		std::vector<uint16_t> local;
+		std::vector<glm::ivec3> handoff;
+	};
+
+	ActiveSet cells;
+	std::vector<glm::ivec3> edited;
+
+	{
+		std::lock_guard lock {mutex};
+		std::swap(cells, active);
+		std::swap(edited, edits);
+	}
+
+	insert(cells, edited, dependants);
+
+	// the tasks read the state from before the tick from the snapshots and write to the chunks, as the chunks copy their
+	// data before writing to it when a snapshot shares it, the snapshots are unaffected by the writes of other tasks
+	ankerl::unordered_dense::map<glm::ivec3, ChunkSnapshot> snapshots;
+	std::vector<Job> jobs;
+	jobs.reserve(cells.size());
+
+	for (auto& [key, group] : cells) {
+		std::shared_ptr<Chunk> chunk = world.getChunk(key.x, key.y, key.z).lock();
+
+		// activations in unloaded chunks are dropped
+		if (!chunk) {
+			continue;
+		}
+
+		Job& job = jobs.emplace_back();
+		job.key = key;
+		job.chunk = std::move(chunk);
+		job.cells = std::move(group.indices);
+
+		for (int i = 0; i < 27; i ++) {
+			glm::ivec3 pos = key + glm::ivec3 {i % 3 - 1, i / 3 % 3 - 1, i / 9 - 1};
+			auto it = snapshots.find(pos);
+
+			if (it == snapshots.end()) {
+				std::shared_ptr<Chunk> neighbour = world.getChunk(pos.x, pos.y, pos.z).lock();
+				it = snapshots.emplace(pos, neighbour ? neighbour->snapshot() : ChunkSnapshot {}).first;
+			}
+
+			job.around[i] = it->second ? &*it->second : nullptr;
+		}
+	}
+
+	std::vector<std::future<bool>> futures;
+	futures.reserve(jobs.size());
+
+	for (Job& job : jobs) {
+		futures.push_back(pool.defer([&job] () {
+			const glm::ivec3 origin = job.key * Chunk::size;
+			const ChunkData& previous = *job.around[13];
+
+			for (uint16_t index : job.cells) {
+				glm::ivec3 pos {index & Chunk::mask, (index >> Chunk::bits) & Chunk::mask, index >> (2 * Chunk::bits)};
+				Block block = evaluate(job.around, pos);
+
+				if (block == previous.getBlock(pos.x, pos.y, pos.z)) {
+					continue;
+				}
+
+				job.chunk->setBlock(pos.x, pos.y, pos.z, block);
+				job.changes.push_back({origin + pos, block});
+
+				for (glm::ivec3 offset : dependants) {
+					glm::ivec3 target = pos + offset;
+
+					if (((target.x | target.y | target.z) & ~Chunk::mask) == 0) {
+						job.local.push_back(indexOf(target));
+					} else {
+						job.handoff.push_back(origin + target);
+					}
+				}
+			}
+
+			return true;
+		}));
+	}
+
+	for (auto& future : futures) {
+		future.get();
+	}
+
+	std::lock_guard lock {mutex};
+
+	for (Job& job : jobs) {
+		changes.insert(changes.end(), job.changes.begin(), job.changes.end());
+
+		if (!job.local.empty()) {
+			ActiveCells& group = active[job.key];
+
+			for (uint16_t index : job.local) {
+				group.add(index);
+			}
+		}
+	}
+
+	// handed off after all the chunk local activations, so that each chunk is looked up only once for those
+	for (Job& job : jobs) {
+		insert(active, job.handoff, std::span {dependants, 1});
+	}
+
+}
+
+size_t FluidSimulator::pending() {
+	std::lock_guard lock {mutex};
+	size_t count = edits.size();
+
+	for (auto& [key, group] : active) {
+		count += group.indices.size();
+	}
+
+	return count;
+}
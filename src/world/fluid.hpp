@@ -0,0 +1,75 @@
+#pragma once
+
+#include "external.hpp"
+#include "block.hpp"
+#include "chunk.hpp"
+
+class World;
+class TaskPool;
+
+/**
+ * Simulates the fluids stored in the block fluid nibbles, only the cells that could change in the next tick
+ * (the ones that changed in the previous tick, or had a neighbour change) are kept in an active set, grouped by chunk,
+ * so settled fluid costs nothing. Each cell pulls its next state from the previous state of its neighbours, so the
+ * active chunks can be processed in parallel, with activations that cross a chunk border handed off after the tick.
+ *
+ * @verbatim
+ * amount 7:    source, never changes on its own
+ * amount 6:    falling, the cell above holds fluid
+ * amount 1-5:  flowing, one less than the highest horizontal neighbour that rests on something
+ */
+class FluidSimulator {
+
+	public:
+
+		static constexpr uint8_t source = 7;
+		static constexpr uint8_t falling = source - 1;
+
+		/// Creates a block holding the given amount of fluid, or air for zero
+		static Block fluid(uint8_t type, uint8_t amount);
+
+		/// Checks if the given block is not a solid block and holds some fluid
+		static bool isFluid(Block block);
+
+	private:
+
+		static constexpr int volume = Chunk::size * Chunk::size * Chunk::size;
+
+		// the active cells of one chunk, as chunk local indices (x + y*32 + z*1024)
+		struct ActiveCells {
+			std::vector<uint16_t> indices;
+			std::vector<uint64_t> marked = std::vector<uint64_t>(volume / 64);
+
+			/// Adds the cell with the given index, unless it's already present
+			void add(uint16_t index);
+		};
+
+		using ActiveSet = ankerl::unordered_dense::map<glm::ivec3, ActiveCells>;
+
+		std::mutex mutex;
+		ActiveSet active;
+
+		// edited positions, only expanded into the active set at the start of the next tick
+		// to keep the edits cheap, most of them happen nowhere near any fluid
+		std::vector<glm::ivec3> edits;
+
+		/// Adds the cells at the given world positions, shifted by each of the offsets, to the active set
+		static void insert(ActiveSet& set, const std::vector<glm::ivec3>& positions, std::span<const glm::ivec3> offsets);
+
+		/// Computes the next state of the cell at the given chunk local position, the position can be
+		/// off by one in any direction, `around` is the 3x3x3 chunk neighbourhood with null for unloaded chunks
+		static Block evaluate(const ChunkData* const around[27], glm::ivec3 pos);
+
+	public:
+
+		/// Marks the cell at the given world position and all the cells whose next state depends on it for evaluation
+		void activate(glm::ivec3 pos);
+
+		/// Runs one simulation step, each active chunk is evaluated as a separate task on the given pool,
+		/// writes the changed cells to the world chunks and appends them to `changes` (grouped by chunk)
+		void tick(World& world, TaskPool& pool, std::vector<BlockEdit>& changes);
+
+		/// Returns the number of active cells and queued edits, this is zero once all the fluid settles
+		size_t pending();
+
+};
@@ -3,62 +3,419 @@
 #include "util/timer.hpp"
 #include "util/logger.hpp"
 
-WorldGenerator::WorldGenerator(size_t seed)
-: noise(seed) {}
+static constexpr float noise_scale = 16.0f;
+static constexpr int max_height = 60;
+
+// no column is taller than this, as both the multiplier and the 2D octave noise are at most one
+static constexpr int terrain_ceiling = 16 + max_height - max_height / 2;
+
+// the top blocks of each column are grass or air, only the ones below are always stone (or caves)
+static constexpr int grass_depth = 2;
+
+// the number of partially generated chunks kept by the pipeline
+static constexpr size_t pipeline_capacity = 2048;
+
+// one in this many chunks starts a worm cave, the worms are short enough to never reach past the neighbouring chunks
+static constexpr int worm_chance = 3;
+static constexpr int worm_length = 20;
+
+// the number of places in each chunk where a tree can grow, if there is grass
+static constexpr int tree_attempts = 4;
+
+// keeps the random numbers of the different stages unrelated
+static constexpr uint64_t worm_salt = 0x6a09e667f3bcc908;
+static constexpr uint64_t tree_salt = 0xbb67ae8584caa73b;
+
+/// A small counter based random number generator (SplitMix64), the stages use it to place features
+/// that span many chunks, every one of those chunks has to draw the exact same numbers for them
+static uint64_t nextRandom(uint64_t& state) {
+	uint64_t z = (state += 0x9e3779b97f4a7c15);
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+	return z ^ (z >> 31);
+}
+
+/// Returns a random float in the range [0, 1)
+static float nextFloat(uint64_t& state) {
+	return (nextRandom(state) >> 40) / (float) (1 << 24);
+}
+
+/// Returns the initial random state for the features that start in the given chunk
+static uint64_t seedOf(uint64_t seed, glm::ivec3 pos, uint64_t salt) {
+	uint64_t state = seed ^ salt;
+	state ^= nextRandom(state) ^ (uint32_t) pos.x;
+	state ^= nextRandom(state) ^ (uint32_t) pos.y;
+	state ^= nextRandom(state) ^ (uint32_t) pos.z;
+	return state;
+}
+
+/// Interpolates the column at the given chunk local position from the lattice sampled by WorldGenerator::sampleLattice
+static void interpolateColumn(const std::vector<double>& lattice, int step, int x, int z, int count, double* out) {
+	const int n = Chunk::size / step + 1;
+	const int lx = x / step;
+	const int lz = z / step;
+	const double fx = (x % step) / (double) step;
+	const double fz = (z % step) / (double) step;
+
+	// first interpolate the four surrounding vertical lines of the lattice into one
+	double line[Chunk::size + 1];
+	const int layers = (count - 1) / step + 2;
+
+	for (int ly = 0; ly < layers; ly++) {
+		const double* layer = lattice.data() + ly * n * n;
+
+		double near = std::lerp(layer[lx + lz * n], layer[lx + 1 + lz * n], fx);
+		double far = std::lerp(layer[lx + (lz + 1) * n], layer[lx + 1 + (lz + 1) * n], fx);
+		line[ly] = std::lerp(near, far, fz);
+	}
+
+	for (int y = 0; y < count; y++) {
+		out[y] = std::lerp(line[y / step], line[y / step + 1], (y % step) / (double) step);
+	}
+}
+
+std::shared_ptr<const WorldGenerator::ColumnNoise> WorldGenerator::computeColumn(glm::ivec2 column) const {
+	constexpr int area = Chunk::size * Chunk::size;
+	auto result = std::make_shared<ColumnNoise>();
+
+	// the whole column is evaluated in two batches, the coordinates are rounded to float first, the same as before
+	std::vector<double> xs(area), zs(area), depth(area, 2137), multipliers(area), octaves(area);
+
+	for (int i = 0; i < area; i ++) {
+		xs[i] = (column.x * Chunk::size + i % Chunk::size) / 128.0f;
+		zs[i] = (column.y * Chunk::size + i / Chunk::size) / 128.0f;
+	}
+
+	batch.noise3D_01(xs, zs, depth, multipliers);
+
+	for (int i = 0; i < area; i ++) {
+		xs[i] = (column.x * Chunk::size + i % Chunk::size) / noise_scale;
+		zs[i] = (column.y * Chunk::size + i / Chunk::size) / noise_scale;
+	}
+
+	batch.octave2D_01(xs, zs, octaves, 2);
+
+	result->lowest = terrain_ceiling;
+	result->highest = -terrain_ceiling;
+
+	for (int i = 0; i < area; i ++) {
+		float multiplier = multipliers[i];
+		int height = (16 * multiplier + octaves[i] * max_height * multiplier) - max_height * 0.5f;
+
+		result->multipliers[i] = multiplier;
+		result->heights[i] = height;
+		result->lowest = std::min(result->lowest, height);
+		result->highest = std::max(result->highest, height);
+	}
+
+	return result;
+}
+
+std::shared_ptr<const WorldGenerator::ColumnNoise> WorldGenerator::getColumn(glm::ivec2 column) {
+	if (capacity == 0) {
+		return computeColumn(column);
+	}
+
+	{
+		std::lock_guard lock {mutex};
+		auto it = columns.find(column);
+
+		if (it != columns.end()) {
+			order.splice(order.begin(), order, it->second.order);
+			return it->second.noise;
+		}
+	}
+
+	// computed without holding the lock, if two threads miss the same column both compute it
+	std::shared_ptr<const ColumnNoise> result = computeColumn(column);
+
+	std::lock_guard lock {mutex};
+	auto [it, inserted] = columns.try_emplace(column);
+
+	if (inserted) {
+		order.push_front(column);
+		it->second = {order.begin(), result};
+	}
+
+	while (columns.size() > capacity) {
+		columns.erase(order.back());
+		order.pop_back();
+	}
+
+	return result;
+}
+
+std::vector<double> WorldGenerator::sampleLattice(glm::ivec3 pos, int step, int top) const {
+	const int n = Chunk::size / step + 1;
+	const int layers = (top - 1) / step + 2;
+	const int count = n * n * layers;
+
+	std::vector<double> xs(count), ys(count), zs(count), values(count);
+
+	for (int i = 0; i < count; i ++) {
+		xs[i] = (pos.x * Chunk::size + i % n * step) / noise_scale;
+		zs[i] = (pos.z * Chunk::size + i / n % n * step) / noise_scale;
+		ys[i] = (pos.y * Chunk::size + i / (n * n) * step) / noise_scale;
+	}
+
+	batch.octave3D_01(xs, ys, zs, values, 3);
+	return values;
+}
+
+WorldGenerator::WorldGenerator(size_t seed, size_t capacity)
+: seed(seed), noise(seed), batch(noise), capacity(capacity), pipeline(*this, pipeline_capacity) {}
+
+void WorldGenerator::setDensity(Density density) {
+	this->density = density;
+}
+
+WorldGenerator::Density WorldGenerator::getDensity() const {
+	return density;
+}
 
 Chunk* WorldGenerator::get(glm::ivec3 pos) {
+	Chunk* chunk = pipeline.get(pos);
+
+	// the generator output can always be generated again, so there is no need to store it
+	chunk->setModified(false);
+	return chunk;
+}
+
+GenerationPipeline& WorldGenerator::getPipeline() {
+	return pipeline;
+}
+
+Chunk* WorldGenerator::terrain(glm::ivec3 pos) {
 
 	Chunk* chunk;
 
 	/*logger::info("Chunk generation took: ", Timer::of(*/[&] () {
 
-		const float noise_scale = 16.0f;
-		const int max_height = 60;
-
 		chunk = new Chunk(pos);
 
 		if (pos == glm::ivec3 {0, 4, 0}) {
-			for (int x = 0; x < Chunk::size; x++) {
-				for (int y = 0; y < Chunk::size; y++) {
-					for (int z = 0; z < Chunk::size; z++) {
-						chunk->setBlock(x, y, z, Block {1});
-					}
-				}
-			}
+			chunk->fill(Block {1});
+			return;
+		}
+
+		// chunks above the tallest possible terrain are always empty, so the column noise is not even needed
+		if (pos.y * Chunk::size >= terrain_ceiling) {
+			return;
+		}
+
+		std::shared_ptr<const ColumnNoise> column = getColumn({pos.x, pos.z});
+		const int step = (int) density;
 
+		if (pos.y * Chunk::size >= column->highest) {
 			return;
 		}
 
+		// every block of a buried chunk is either stone or a cave, so it's filled
+		// with stone up front and only the (much less common) caves are written
+		const bool buried = (pos.y + 1) * Chunk::size <= column->lowest - grass_depth;
+
+		if (buried) {
+			chunk->fill(Block {1});
+		}
+
+		// the tallest run of blocks below the surface, the 3D noise is never needed above it
+		int top = 0;
+
+		for (int height : column->heights) {
+			top = std::clamp(height - pos.y * Chunk::size, top, Chunk::size);
+		}
+
+		std::vector<double> lattice;
+
+		if (step > 1 && top > 0) {
+			lattice = sampleLattice(pos, step, top);
+		}
+
+		// in full density the 3D noise is evaluated one vertical run of blocks at a time
+		double xs[Chunk::size], ys[Chunk::size], zs[Chunk::size], values[Chunk::size];
+
+		for (int y = 0; y < Chunk::size; y++) {
+			ys[y] = (pos.y * Chunk::size + y) / noise_scale;
+		}
+
 		for (int x = 0; x < Chunk::size; x++) {
 			for (int z = 0; z < Chunk::size; z++) {
 				int xpos = pos.x * Chunk::size + x;
 				int ypos = pos.y * Chunk::size;
 				int zpos = pos.z * Chunk::size + z;
 
-				float multiplier = noise.noise3D_01(xpos / 128.0f, zpos / 128.0f, 2137);
-				int height = (16 * multiplier + noise.octave2D_01(xpos / noise_scale, zpos / noise_scale, 2) * max_height * multiplier) - max_height * 0.5f;
+				float multiplier = column->multipliers[x + z * Chunk::size];
+				int height = column->heights[x + z * Chunk::size];
 
 				if (ypos < height) {
 					int local_height = std::min(Chunk::size, height - ypos);
+
+					if (step > 1) {
+						interpolateColumn(lattice, step, x, z, local_height, values);
+					} else {
+						std::fill_n(xs, local_height, xpos / noise_scale);
+						std::fill_n(zs, local_height, zpos / noise_scale);
+						batch.octave3D_01({xs, (size_t) local_height}, {ys, (size_t) local_height}, {zs, (size_t) local_height}, {values, (size_t) local_height}, 3);
+					}
+
+					// pick the blocks of this column first, they are then written as vertical runs of the same block
+					Block::packed_type blocks[Chunk::size];
+
 					for (int y = 0; y < local_height; y++) {
 
-						float block_noise = noise.octave3D_01(xpos / noise_scale, (ypos + y) / noise_scale, zpos / noise_scale, 3);
+						float block_noise = values[y];
+
+						if (buried) {
+							blocks[y] = block_noise >= 0.7 ? 0 : 1; // cave or stone
+							continue;
+						}
+
+						blocks[y] = 0; // air
 
 						if (block_noise < 0.7) {
-							if (y + ypos < height - 2) {
-								chunk->setBlock(x, y, z, Block{1}); // stone
+							if (y + ypos < height - grass_depth) {
+								blocks[y] = 1; // stone
 							} else {
 								if (block_noise < ((1 - multiplier) * 0.3 + 0.5)) {
-									chunk->setBlock(x, y, z, Block{2}); // grass
+									blocks[y] = 2; // grass
 								}
 							}
 						}
 					}
+
+					// the chunk already holds stone (when buried) or air, so only the other runs are written
+					const Block::packed_type background = buried ? 1 : 0;
+
+					for (int y = 0; y < local_height;) {
+						int end = y + 1;
+
+						while (end < local_height && blocks[end] == blocks[y]) {
+							end ++;
+						}
+
+						if (blocks[y] != background) {
+							chunk->fillColumn(x, z, y, end - y, Block {blocks[y]});
+						}
+
+						y = end;
+					}
 				}
 			}
 		}
 
+		// collapses fully solid (or fully empty) chunks into the uniform representation
+		chunk->compact();
+
 	}();/*).milliseconds(), "ms");*/
 
 	return chunk;
-}
\ No newline at end of file
+}
+
+void WorldGenerator::carve(Chunk& chunk, const ChunkData* const around[27]) const {
+	for (int i = 0; i < 27; i ++) {
+		const glm::ivec3 offset {i % 3 - 1, i / 3 % 3 - 1, i / 9 - 1};
+		uint64_t state = seedOf(seed, chunk.pos + offset, worm_salt);
+
+		if (nextRandom(state) % worm_chance != 0) {
+			continue;
+		}
+
+		// the path is computed relative to the chunk the worm starts in, so that all the chunks it passes through get the same one
+		glm::vec3 point = glm::vec3 {nextFloat(state), nextFloat(state), nextFloat(state)} * (float) Chunk::size;
+		glm::vec3 direction {nextFloat(state) * 2 - 1, nextFloat(state) - 0.5f, nextFloat(state) * 2 - 1};
+		float radius = 1.5f + nextFloat(state);
+
+		// worms only start in stone, so that they don't open up the surface
+		glm::ivec3 start = glm::floor(point);
+
+		if (around[i]->getBlock(start.x, start.y, start.z) != Block{1}) {
+			continue;
+		}
+
+		// from the coordinates of the chunk the worm starts in to ours
+		const glm::ivec3 shift = offset * Chunk::size;
+
+		for (int step = 0; step < worm_length; step ++) {
+			glm::ivec3 low = glm::max(glm::ivec3 {glm::floor(point - radius)} + shift, glm::ivec3 {0});
+			glm::ivec3 high = glm::min(glm::ivec3 {glm::floor(point + radius)} + shift, glm::ivec3 {Chunk::mask});
+
+			for (int z = low.z; z <= high.z; z++) {
+				for (int y = low.y; y <= high.y; y++) {
+					for (int x = low.x; x <= high.x; x++) {
+						glm::vec3 center = glm::vec3 {glm::ivec3 {x, y, z} - shift} + 0.5f - point;
+
+						if (glm::dot(center, center) <= radius * radius && chunk.getBlock(x, y, z) == Block{1}) {
+							chunk.setBlock(x, y, z, Block{0});
+						}
+					}
+				}
+			}
+
+			direction = glm::vec3 {nextFloat(state) - 0.5f, (nextFloat(state) - 0.5f) * 0.5f, nextFloat(state) - 0.5f} * 0.6f + direction;
+			point += direction / std::max(glm::length(direction), 0.001f);
+		}
+	}
+}
+
+void WorldGenerator::decorate(Chunk& chunk, const ChunkData* const around[27]) const {
+
+	struct Tree {
+		glm::ivec3 base;
+		int height;
+	};
+
+	std::vector<Tree> trees;
+
+	for (int i = 0; i < 27; i ++) {
+		const glm::ivec3 offset {i % 3 - 1, i / 3 % 3 - 1, i / 9 - 1};
+		uint64_t state = seedOf(seed, chunk.pos + offset, tree_salt);
+
+		for (int attempt = 0; attempt < tree_attempts; attempt ++) {
+			int x = nextRandom(state) % Chunk::size;
+			int z = nextRandom(state) % Chunk::size;
+			int height = 4 + nextRandom(state) % 3;
+
+			// the ground is looked for only in the chunk the tree grows from (below its top layer, so that
+			// the block above is in it too), this way every chunk the tree reaches into finds the same one
+			for (int y = Chunk::size - 2; y >= 0; y--) {
+				if (around[i]->getBlock(x, y, z) == Block{2} && around[i]->getBlock(x, y + 1, z).isAir()) {
+					trees.push_back({offset * Chunk::size + glm::ivec3 {x, y + 1, z}, height});
+					break;
+				}
+			}
+		}
+	}
+
+	const auto place = [&] (glm::ivec3 pos, Block block, bool replace_leaves) {
+		if (((pos.x | pos.y | pos.z) & ~Chunk::mask) != 0) {
+			return;
+		}
+
+		Block current = chunk.getBlock(pos.x, pos.y, pos.z);
+
+		if (current.isAir() || (replace_leaves && current == Block{4})) {
+			chunk.setBlock(pos.x, pos.y, pos.z, block);
+		}
+	};
+
+	// the leaves go first, so that the trunks of the trees next to each other can go through them
+	for (const Tree& tree : trees) {
+		for (int dy = tree.height - 2; dy <= tree.height; dy++) {
+			const int reach = dy == tree.height ? 1 : 2;
+
+			for (int dz = -reach; dz <= reach; dz++) {
+				for (int dx = -reach; dx <= reach; dx++) {
+					if (std::abs(dx) != 2 || std::abs(dz) != 2) {
+						place(tree.base + glm::ivec3 {dx, dy, dz}, Block{4}, false); // leaves
+					}
+				}
+			}
+		}
+	}
+
+	for (const Tree& tree : trees) {
+		for (int dy = 0; dy < tree.height; dy++) {
+			place(tree.base + glm::ivec3 {0, dy, 0}, Block{3}, true); // log
+		}
+	}
+}
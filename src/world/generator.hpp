@@ -2,18 +2,93 @@
 
 #include "external.hpp"
 #include "chunk.hpp"
+#include "util/math/noise.hpp"
+#include "pipeline.hpp"
 
 class WorldGenerator {
 
+	public:
+
+		/// How densely the 3D terrain noise is sampled, the coarse modes sample it only every 4 or 8
+		/// blocks along each axis and interpolate in between, which is much cheaper but less detailed
+		enum struct Density : uint8_t {
+			FULL = 1,
+			COARSE_4 = 4,
+			COARSE_8 = 8
+		};
+
 	private:
 
+		// the 2D noise of one chunk column, it's the same for all chunks in that column
+		struct ColumnNoise {
+			int heights[Chunk::size * Chunk::size];
+			float multipliers[Chunk::size * Chunk::size];
+
+			// the range of the heights above, used to classify the chunks of this column
+			int lowest;
+			int highest;
+		};
+
+		struct Entry {
+			std::list<glm::ivec2>::iterator order;
+			std::shared_ptr<const ColumnNoise> noise;
+		};
+
+		uint64_t seed;
 		siv::PerlinNoise noise;
+		BatchNoise batch;
+		Density density = Density::FULL;
+
+		// small LRU cache of the column noise, the chunks of one column are usually requested close together
+		std::mutex mutex;
+		size_t capacity;
+		std::list<glm::ivec2> order;
+		ankerl::unordered_dense::map<glm::ivec2, Entry> columns;
+
+		/// Computes the 2D noise of the given column
+		std::shared_ptr<const ColumnNoise> computeColumn(glm::ivec2 column) const;
+
+		/// Returns the 2D noise of the given column, computing (and caching) it if needed
+		std::shared_ptr<const ColumnNoise> getColumn(glm::ivec2 column);
+
+		/// Samples the 3D noise of the given chunk on the coarse lattice, up to (and including) the first lattice layer
+		/// at or above `top`, the values are stored as x + z * n + y * n * n where n is the number of points along an axis
+		std::vector<double> sampleLattice(glm::ivec3 pos, int step, int top) const;
+
+		// needs to be declared last, so that its jobs are done before the rest of the generator is destroyed
+		GenerationPipeline pipeline;
 
 	public:
 
-		WorldGenerator(size_t seed);
+		/// Creates a generator that caches the noise of the given number of most recently used columns, zero disables the cache
+		WorldGenerator(size_t seed, size_t capacity = 256);
+
+		/// Selects how densely the 3D noise is sampled, must not be called while chunks are being generated
+		void setDensity(Density density);
+
+		/// Returns the selected 3D noise density
+		Density getDensity() const;
 
-		/// Generates (as in world generation, not meshing) the requested chunk and returns it
+		/// Generates (as in world generation, not meshing) the requested chunk through all the stages of the
+		/// pipeline and returns it, blocks until it's done, safe to call from many threads
 		Chunk* get(glm::ivec3 pos);
 
+		/// Returns the pipeline that runs the generation stages
+		GenerationPipeline& getPipeline();
+
+	public:
+
+		// The generation stages, called by the pipeline, each one is deterministic so that a chunk can be generated again
+		// if needed, and the neighbourhoods passed to them hold the 3x3x3 chunks around (and including) the generated one,
+		// indexed as (x + 1) + (y + 1) * 3 + (z + 1) * 9, as they were after the previous stage
+
+		/// The first stage, generates the terrain of the given chunk, it doesn't depend on the neighbours
+		Chunk* terrain(glm::ivec3 pos);
+
+		/// The second stage, carves the worm caves, those can start in any of the neighbours
+		void carve(Chunk& chunk, const ChunkData* const around[27]) const;
+
+		/// The third stage, places the trees, those can grow from the ground in any of the neighbours
+		void decorate(Chunk& chunk, const ChunkData* const around[27]) const;
+
 };
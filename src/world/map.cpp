@@ -0,0 +1,83 @@
+
+#include "map.hpp"
+
+/*
+ * ColumnMap
+ */
+
+ColumnMap::Shard& ColumnMap::shardOf(glm::ivec2 column) {
+	const uint32_t x = column.x >> region_bits;
+	const uint32_t z = column.y >> region_bits;
+
+	// spread neighbouring regions across different shards
+	return slots[((x * 73856093) ^ (z * 19349663)) & (shards - 1)];
+}
+
+std::weak_ptr<Chunk> ColumnMap::get(glm::ivec3 pos) {
+	const glm::ivec2 key {pos.x, pos.z};
+	Shard& shard = shardOf(key);
+
+	std::shared_lock lock {shard.mutex};
+	auto it = shard.columns.find(key);
+
+	if (it == shard.columns.end()) {
+		return {};
+	}
+
+	return it->second.get(pos.y);
+}
+
+void ColumnMap::emplace(Chunk* chunk) {
+	const glm::ivec2 key {chunk->pos.x, chunk->pos.z};
+	Shard& shard = shardOf(key);
+
+	std::unique_lock lock {shard.mutex};
+	shard.columns[key].emplace(chunk);
+}
+
+bool ColumnMap::contains(glm::ivec3 pos) {
+	const glm::ivec2 key {pos.x, pos.z};
+	Shard& shard = shardOf(key);
+
+	std::shared_lock lock {shard.mutex};
+	auto it = shard.columns.find(key);
+
+	return it != shard.columns.end() && it->second.contains(pos.y);
+}
+
+size_t ColumnMap::size() {
+	size_t count = 0;
+
+	for (Shard& shard : slots) {
+		std::shared_lock lock {shard.mutex};
+		count += shard.columns.size();
+	}
+
+	return count;
+}
+
+int ColumnMap::getHeight(int x, int z) {
+	const glm::ivec2 key {x >> Chunk::bits, z >> Chunk::bits};
+	Shard& shard = shardOf(key);
+
+	std::shared_lock lock {shard.mutex};
+	auto it = shard.columns.find(key);
+
+	if (it == shard.columns.end()) {
+		return ChunkColumn::no_height;
+	}
+
+	return it->second.getHeight(x & Chunk::mask, z & Chunk::mask);
+}
+
+void ColumnMap::updateHeight(int x, int z, int low, int high, bool air) {
+	const glm::ivec2 key {x >> Chunk::bits, z >> Chunk::bits};
+	Shard& shard = shardOf(key);
+
+	std::unique_lock lock {shard.mutex};
+	auto it = shard.columns.find(key);
+
+	if (it != shard.columns.end()) {
+		it->second.updateHeight(x & Chunk::mask, z & Chunk::mask, low, high, air);
+	}
+}
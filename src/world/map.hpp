@@ -0,0 +1,73 @@
+#pragma once
+
+#include "external.hpp"
+#include "column.hpp"
+
+/**
+ * Sharded map of chunk columns, columns are grouped into small square regions and each region
+ * is assigned to one of the shards. Every shard has its own reader-writer lock so lookups only ever take
+ * a shared lock (and never contend with each other) while writers only block the shard they modify.
+ */
+class ColumnMap {
+
+	public:
+
+		static constexpr int shards = 64;
+		static constexpr int region_bits = 2;
+
+		static_assert(std::popcount((size_t) shards) == 1, "ColumnMap::shards needs to be a power of 2");
+
+	private:
+
+		struct Shard {
+			std::shared_mutex mutex;
+			ankerl::unordered_dense::map<glm::ivec2, ChunkColumn> columns;
+		};
+
+		std::array<Shard, shards> slots;
+
+		/// Get the shard responsible for the given column
+		Shard& shardOf(glm::ivec2 column);
+
+	public:
+
+		/// Returns the chunk at the specified chunk coordinates, or an empty pointer
+		std::weak_ptr<Chunk> get(glm::ivec3 pos);
+
+		/// Replace or add a new chunk to the map, the map takes ownership
+		void emplace(Chunk* chunk);
+
+		/// Check if the map contains chunk at the given chunk coordinates
+		bool contains(glm::ivec3 pos);
+
+		/// Returns the total number of columns in the map
+		size_t size();
+
+		/// Returns the world Y of the highest loaded non-air block at the given world X and Z, or ChunkColumn::no_height
+		int getHeight(int x, int z);
+
+		/// Updates the column heightmap after all the blocks in the given world Y range
+		/// (inclusive) at the given world X and Z were set to air or to some non-air block
+		void updateHeight(int x, int z, int low, int high, bool air);
+
+		/**
+		 * Iterates all columns, with each shard exclusively locked while its columns
+		 * are visited, the columns for which the function returns false are removed
+		 */
+		template <typename Func>
+		void filter(Func func) {
+			for (Shard& shard : slots) {
+				std::unique_lock lock {shard.mutex};
+
+				for (auto it = shard.columns.begin(); it != shard.columns.end();) {
+					if (!func(it->first, it->second)) {
+						it = shard.columns.erase(it);
+						continue;
+					}
+
+					std::advance(it, 1);
+				}
+			}
+		}
+
+};
@@ -0,0 +1,259 @@
+
+#include "palette.hpp"
+
+/*
+ * BlockPalette
+ */
+
+int BlockPalette::find(Block block) const {
+	if ((int) palette.size() > linear_limit) {
+		auto it = lookup.find(block.packed());
+		return it == lookup.end() ? -1 : it->second;
+	}
+
+	for (int i = 0; i < (int) palette.size(); i ++) {
+		if (palette[i] == block) {
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+void BlockPalette::reclaim(std::vector<uint16_t>& remap) {
+	std::vector<int> usages(palette.size(), 0);
+	std::vector<Block> compacted;
+
+	for (int i = 0; i < count; i ++) {
+		usages[read(i)] ++;
+	}
+
+	for (int i = 0; i < (int) palette.size(); i ++) {
+		if (usages[i] != 0) {
+			remap[i] = compacted.size();
+			compacted.push_back(palette[i]);
+		}
+	}
+
+	palette = std::move(compacted);
+	lookup.clear();
+
+	if ((int) palette.size() > linear_limit) {
+		for (int i = 0; i < (int) palette.size(); i ++) {
+			lookup[palette[i].packed()] = i;
+		}
+	}
+}
+
+int BlockPalette::insert(Block block) {
+	if ((int) palette.size() >= (1 << bits)) {
+		std::vector<uint16_t> remap(palette.size(), 0);
+		int width = std::max(bits, 1);
+
+		// before widening the indices try to reclaim stale palette entries, in the
+		// uniform case there is nothing to reclaim as the only entry is always in use
+		if (bits != 0) {
+			reclaim(remap);
+		}
+
+		int used = palette.size();
+
+		while ((1 << width) <= used) {
+			width *= 2;
+		}
+
+		// if we were to keep the width while being more than half full
+		// we would end up compacting again in a moment, so widen anyway
+		if (width == bits && used * 2 > (1 << bits)) {
+			width *= 2;
+		}
+
+		repack(width, remap);
+	}
+
+	int index = palette.size();
+	palette.push_back(block);
+
+	if ((int) palette.size() > linear_limit) {
+
+		// we just crossed the limit, the map needs to be populated
+		if (lookup.empty()) {
+			for (int i = 0; i < index; i ++) {
+				lookup[palette[i].packed()] = i;
+			}
+		}
+
+		lookup[block.packed()] = index;
+	}
+
+	return index;
+}
+
+void BlockPalette::repack(int width, const std::vector<uint16_t>& remap) {
+	const size_t length = ((size_t) count * width + word_bits - 1) / word_bits;
+	const word_type mask = (word_type {1} << width) - 1;
+
+	word_type* packed = (word_type*) std::calloc(length, sizeof(word_type));
+
+	// when coming from the uniform state all indices are zero, and zero
+	// is always remapped to zero, so the cleared array is already correct
+	if (bits != 0) {
+		for (int i = 0; i < count; i ++) {
+			const size_t bit = (size_t) i * width;
+			packed[bit / word_bits] |= (remap[read(i)] & mask) << (bit % word_bits);
+		}
+	}
+
+	std::free(words);
+	words = packed;
+	bits = width;
+}
+
+uint32_t BlockPalette::read(int index) const {
+	const size_t bit = (size_t) index * bits;
+	const word_type mask = (word_type {1} << bits) - 1;
+
+	return (words[bit / word_bits] >> (bit % word_bits)) & mask;
+}
+
+void BlockPalette::write(int index, uint32_t value) {
+	const size_t bit = (size_t) index * bits;
+	const word_type mask = (word_type {1} << bits) - 1;
+	const int shift = bit % word_bits;
+
+	word_type& word = words[bit / word_bits];
+	word = (word & ~(mask << shift)) | ((word_type) value << shift);
+}
+
+BlockPalette::BlockPalette(int count)
+: count(count) {
+	palette.push_back(Block {0});
+}
+
+BlockPalette::BlockPalette(const BlockPalette& other)
+: count(other.count), bits(other.bits), palette(other.palette), lookup(other.lookup) {
+	if (other.words) {
+		const size_t length = ((size_t) count * bits + word_bits - 1) / word_bits;
+
+		words = (word_type*) std::malloc(length * sizeof(word_type));
+		std::copy_n(other.words, length, words);
+	}
+}
+
+BlockPalette::~BlockPalette() {
+	std::free(words);
+}
+
+void BlockPalette::set(int index, Block block) {
+	int id = find(block);
+
+	if (id == -1) {
+		id = insert(block);
+	}
+
+	// in the uniform state the block must have been
+	// found as the first entry, so there is nothing to write
+	if (bits != 0) {
+		write(index, id);
+	}
+}
+
+void BlockPalette::set(int index, int count, int stride, Block block) {
+	int id = find(block);
+
+	if (id == -1) {
+		id = insert(block);
+	}
+
+	if (bits != 0) {
+		for (int i = 0; i < count; i ++) {
+			write(index + i * stride, id);
+		}
+	}
+}
+
+void BlockPalette::set(int index, const Block* blocks, int count) {
+	int id = 0;
+
+	for (int i = 0; i < count; i ++) {
+
+		// the palette is only searched when the block changes, an insert can
+		// remap the entries but it also returns the new index of the inserted one
+		if (i == 0 || blocks[i] != blocks[i - 1]) {
+			id = find(blocks[i]);
+
+			if (id == -1) {
+				id = insert(blocks[i]);
+			}
+		}
+
+		if (bits != 0) {
+			write(index + i, id);
+		}
+	}
+}
+
+Block BlockPalette::get(int index) const {
+	if (bits == 0) {
+		return palette[0];
+	}
+
+	return palette[read(index)];
+}
+
+void BlockPalette::fill(Block block) {
+	std::free(words);
+	words = nullptr;
+	bits = 0;
+
+	palette.clear();
+	palette.push_back(block);
+	lookup.clear();
+}
+
+void BlockPalette::compact() {
+	if (bits == 0) {
+		return;
+	}
+
+	std::vector<uint16_t> remap(palette.size(), 0);
+	reclaim(remap);
+
+	if (palette.size() == 1) {
+		return fill(palette[0]);
+	}
+
+	int width = 1;
+
+	while ((1 << width) < (int) palette.size()) {
+		width *= 2;
+	}
+
+	repack(width, remap);
+}
+
+bool BlockPalette::uniform() const {
+	return bits == 0;
+}
+
+int BlockPalette::width() const {
+	return bits;
+}
+
+int BlockPalette::size() const {
+	return palette.size();
+}
+
+const std::vector<Block>& BlockPalette::entries() const {
+	return palette;
+}
+
+size_t BlockPalette::bytes() const {
+	size_t indices = ((size_t) count * bits + word_bits - 1) / word_bits * sizeof(word_type);
+	size_t entries = palette.capacity() * sizeof(Block);
+
+	// this is only an estimate, the map has some internal overhead we can't see
+	size_t map = lookup.size() * (sizeof(Block::packed_type) + sizeof(uint16_t) + sizeof(uint32_t));
+
+	return indices + entries + map;
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "external.hpp"
+#include "block.hpp"
+#include "util/math/bits.hpp"
+
+/**
+ * Palette-compressed block array, instead of storing a full Block for every
+ * position it keeps a small list of unique blocks (the palette) and a bit-packed array
+ * of indices into that list. The index width is always a power of two (1, 2, 4, 8 or 16 bits)
+ * so that no index ever straddles two words, it starts at zero bits (all positions share the
+ * first palette entry) and is widened on demand when the palette overflows.
+ *
+ * @verbatim
+ * distinct blocks: 1    2     3-4   5-16   17-256   257-65536
+ * index width:     0    1     2     4      8        16
+ */
+class BlockPalette {
+
+	private:
+
+		using word_type = uint64_t;
+
+		static constexpr int word_bits = Bits::width<word_type>();
+
+		/// above this palette size a hash map is used for block to index lookups
+		static constexpr int linear_limit = 16;
+
+		READONLY int count;
+		int bits = 0;
+		word_type* words = nullptr;
+
+		std::vector<Block> palette;
+		ankerl::unordered_dense::map<Block::packed_type, uint16_t> lookup;
+
+		/// Returns the palette index of the given block or -1 if it's not in the palette
+		int find(Block block) const;
+
+		/// Drops palette entries no longer referenced by any index, fills the remapping table
+		void reclaim(std::vector<uint16_t>& remap);
+
+		/// Adds a new block to the palette, this can compact or widen the index array
+		int insert(Block block);
+
+		/// Re-packs the index array using the given index width and palette remapping
+		void repack(int width, const std::vector<uint16_t>& remap);
+
+		/// Reads the raw palette index at the given position
+		uint32_t read(int index) const;
+
+		/// Writes the raw palette index at the given position
+		void write(int index, uint32_t value);
+
+	public:
+
+		BlockPalette(int count);
+		BlockPalette(const BlockPalette& other);
+		~BlockPalette();
+
+		BlockPalette& operator =(const BlockPalette& other) = delete;
+
+		/// Sets the block at the given index
+		void set(int index, Block block);
+
+		/// Sets `count` positions, starting at the given index and `stride` apart, to the given block
+		void set(int index, int count, int stride, Block block);
+
+		/// Sets `count` consecutive positions, starting at the given index, to the given blocks
+		void set(int index, const Block* blocks, int count);
+
+		/// Gets the block at the given index
+		Block get(int index) const;
+
+		/// Sets all positions to the given block, this puts the storage into the uniform state
+		void fill(Block block);
+
+		/// Drops unused palette entries and narrows the indices, if only
+		/// one block remains in use the storage becomes uniform
+		void compact();
+
+		/// Checks if all positions point to the same palette entry
+		bool uniform() const;
+
+		/// Returns the current width of a single index, in bits
+		int width() const;
+
+		/// Returns the number of entries in the palette, this can include stale (unused) entries
+		int size() const;
+
+		/// Returns the entries of the palette, this can include stale (unused) entries
+		const std::vector<Block>& entries() const;
+
+		/// Returns the number of heap bytes used by this storage (excluding the object itself)
+		size_t bytes() const;
+
+};
@@ -0,0 +1,274 @@
+
+#include "pipeline.hpp"
+#include "generator.hpp"
+#include "util/timer.hpp"
+
+/// Returns the offset of the neighbour with the given index, in the same order as the chunk neighbourhoods passed to the stages
+static glm::ivec3 offsetOf(int index) {
+	return {index % 3 - 1, index / 3 % 3 - 1, index / 9 - 1};
+}
+
+/*
+ * GenerationPipeline
+ */
+
+void GenerationPipeline::raise(glm::ivec3 pos, int target, std::vector<glm::ivec3>& raised) {
+	Entry& entry = entries[pos];
+	entry.touched = time;
+
+	if (entry.target >= target) {
+		return;
+	}
+
+	entry.target = target;
+	raised.push_back(pos);
+
+	// the last of the stages needs the neighbours to have completed the one before it,
+	// this adds entries to the map so the reference above can't be used past this point
+	if (target > 1) {
+		for (int i = 0; i < 27; i ++) {
+			if (i != 13) {
+				raise(pos + offsetOf(i), target - 1, raised);
+			}
+		}
+	}
+}
+
+void GenerationPipeline::tryStart(glm::ivec3 pos) {
+	auto it = entries.find(pos);
+
+	if (it == entries.end()) {
+		return;
+	}
+
+	Entry& entry = it->second;
+	const int stage = entry.done;
+
+	if (entry.running || stage >= entry.target) {
+		return;
+	}
+
+	// the neighbourhood as it was after the previous stage, including this chunk itself
+	std::array<ChunkSnapshot, 27> around;
+
+	if (stage > TERRAIN) {
+		for (int i = 0; i < 27; i ++) {
+			auto neighbour = entries.find(pos + offsetOf(i));
+
+			if (neighbour == entries.end() || neighbour->second.done < stage) {
+				return;
+			}
+
+			around[i] = neighbour->second.results[stage - 1];
+		}
+	}
+
+	entry.running = true;
+	running ++;
+	Chunk* chunk = entry.chunk.release();
+
+	pool.enqueue([this, pos, stage, chunk, around] () {
+		Chunk* result = chunk;
+		double time;
+
+		try {
+			time = Timer::of([&] () {
+				if (stage == TERRAIN) {
+					result = generator.terrain(pos);
+					return;
+				}
+
+				const ChunkData* data[27];
+
+				for (int i = 0; i < 27; i ++) {
+					data[i] = &*around[i];
+				}
+
+				if (stage == CARVING) {
+					generator.carve(*result, data);
+				} else {
+					generator.decorate(*result, data);
+				}
+
+				result->compact();
+			}).nanoseconds();
+		} catch (...) {
+			fail(pos, result, std::current_exception());
+			return;
+		}
+
+		nanos[stage] += (uint64_t) time;
+		jobs[stage] ++;
+
+		complete(pos, result);
+	});
+}
+
+void GenerationPipeline::complete(glm::ivec3 pos, Chunk* chunk) {
+	std::lock_guard lock {mutex};
+
+	// running entries are never pruned, so it's still there
+	Entry& entry = entries.at(pos);
+
+	entry.results[entry.done] = chunk->snapshot();
+	entry.chunk.reset(chunk);
+	entry.running = false;
+	entry.touched = ++ time;
+	entry.done ++;
+	running --;
+
+	// this chunk can continue, and the neighbours could have been waiting for this stage
+	for (int i = 0; i < 27; i ++) {
+		tryStart(pos + offsetOf(i));
+	}
+
+	condition.notify_all();
+}
+
+void GenerationPipeline::fail(glm::ivec3 pos, Chunk* chunk, std::exception_ptr error) {
+	std::lock_guard lock {mutex};
+
+	// the stage could have written only a part of the chunk, so it has to start over
+	Entry& entry = entries.at(pos);
+	delete chunk;
+
+	std::fill_n(entry.results, stages, ChunkSnapshot {});
+	entry.running = false;
+	entry.touched = ++ time;
+	entry.done = TERRAIN;
+	running --;
+
+	// the requests waiting now are all failed, so nothing needs the stages that were still pending,
+	// the running ones can complete, the next request raises the targets again from where they are
+	for (auto& [key, other] : entries) {
+		other.target = other.done + other.running;
+	}
+
+	this->error = error;
+	failures ++;
+
+	condition.notify_all();
+}
+
+void GenerationPipeline::prune() {
+
+	// when not enough entries can be dropped scanning them again on each request would only waste time,
+	// so after that the map needs to grow a bit more first, as the entries needed by a neighbour get finished
+	if (entries.size() <= std::max(capacity, pruned + capacity / 8)) {
+		return;
+	}
+
+	std::vector<std::pair<uint64_t, glm::ivec3>> candidates;
+
+	for (auto& [key, entry] : entries) {
+		if (entry.running || entry.waiters > 0 || entry.done < entry.target) {
+			continue;
+		}
+
+		bool needed = false;
+
+		// still needed as a neighbour by a chunk that has not finished yet
+		for (int i = 0; i < 27 && !needed; i ++) {
+			auto neighbour = entries.find(key + offsetOf(i));
+			needed = neighbour != entries.end() && neighbour->second.done < neighbour->second.target;
+		}
+
+		if (!needed) {
+			candidates.emplace_back(entry.touched, key);
+		}
+	}
+
+	std::sort(candidates.begin(), candidates.end(), [] (const auto& a, const auto& b) {
+		return a.first < b.first;
+	});
+
+	// go a bit below the capacity, so that this doesn't have to run again after the next request
+	const size_t excess = entries.size() - capacity * 3 / 4;
+
+	for (size_t i = 0; i < std::min(excess, candidates.size()); i ++) {
+		entries.erase(candidates[i].second);
+	}
+
+	pruned = entries.size();
+}
+
+GenerationPipeline::GenerationPipeline(WorldGenerator& generator, size_t capacity, size_t threads)
+: generator(generator), capacity(capacity), pool(threads) {}
+
+GenerationPipeline::~GenerationPipeline() {
+	std::unique_lock lock {mutex};
+
+	// let the running stages complete, but don't start any new ones, as the pool no longer accepts them
+	for (auto& [key, entry] : entries) {
+		entry.target = entry.done;
+	}
+
+	condition.wait(lock, [this] () {
+		return running == 0;
+	});
+}
+
+Chunk* GenerationPipeline::get(glm::ivec3 pos) {
+	std::unique_lock lock {mutex};
+	entries[pos].waiters ++;
+	time ++;
+
+	const uint64_t failed = failures;
+
+	while (true) {
+		Entry& entry = entries.at(pos);
+
+		if (entry.done == stages && entry.chunk) {
+			break;
+		}
+
+		// some stage failed while we were waiting, the chunks depending on it will never complete
+		if (failures != failed) {
+			entry.waiters --;
+			std::rethrow_exception(error);
+		}
+
+		// not requested up to the final stage yet, or handed out before, then it's generated again, its old
+		// results stay valid for the neighbours in the meantime, the target is reset so that the neighbours are raised again
+		if (entry.target < stages || (entry.done == stages && !entry.running)) {
+			std::vector<glm::ivec3> raised;
+
+			if (entry.done == stages) {
+				entry.done = TERRAIN;
+			}
+
+			entry.target = TERRAIN;
+			raise(pos, stages, raised);
+
+			for (glm::ivec3 key : raised) {
+				tryStart(key);
+			}
+		}
+
+		condition.wait(lock);
+	}
+
+	Entry& entry = entries.at(pos);
+	Chunk* chunk = entry.chunk.release();
+
+	// nothing runs after the last stage, so its result is never needed
+	entry.results[stages - 1] = {};
+	entry.waiters --;
+	entry.touched = ++ time;
+
+	prune();
+	return chunk;
+}
+
+double GenerationPipeline::getStageTime(Stage stage) const {
+	return nanos[stage] / 1000000.0;
+}
+
+size_t GenerationPipeline::getStageJobs(Stage stage) const {
+	return jobs[stage];
+}
+
+size_t GenerationPipeline::size() {
+	std::lock_guard lock {mutex};
+	return entries.size();
+}
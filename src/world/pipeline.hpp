@@ -0,0 +1,105 @@
+#pragma once
+
+#include "external.hpp"
+#include "chunk.hpp"
+#include "util/thread/pool.hpp"
+
+class WorldGenerator;
+
+/**
+ * Generates the chunks in stages, first the terrain, then the carving and then the decoration. A chunk only runs a stage
+ * once all of its 26 neighbours completed the previous one, so each stage can read the neighbouring chunks (as they were
+ * after the previous stage) to place features that cross the chunk borders, while only ever writing to its own chunk.
+ * Each stage of each chunk runs as a separate job on the pool, and a chunk is only handed out once it's final.
+ *
+ * To finish one chunk its neighbours need to be carved and their neighbours need the terrain, those partially generated
+ * chunks are kept (up to the configured capacity) as the chunks requested next will most likely need them too.
+ */
+class GenerationPipeline {
+
+	public:
+
+		enum Stage : uint8_t {
+			TERRAIN,
+			CARVING,
+			DECORATION
+		};
+
+		static constexpr int stages = 3;
+
+	private:
+
+		struct Entry {
+			// the chunk being generated, null until the terrain is done and after it was handed out
+			std::unique_ptr<Chunk> chunk;
+
+			// the content after each completed stage, read by the neighbours running the next one
+			ChunkSnapshot results[stages];
+
+			int done = 0;
+			int target = 0;
+			int waiters = 0;
+			bool running = false;
+
+			// the pipeline time at which this chunk was last requested or advanced, the oldest are dropped first
+			uint64_t touched = 0;
+		};
+
+		WorldGenerator& generator;
+		size_t capacity;
+
+		std::mutex mutex;
+		std::condition_variable condition;
+		ankerl::unordered_dense::map<glm::ivec3, Entry> entries;
+		uint64_t time = 0;
+		size_t running = 0;
+
+		// the number of entries left by the last prune, the next one waits for the map to grow past that
+		size_t pruned = 0;
+
+		// the number of failed stages, and the error of the last one, rethrown by the requests waiting at the time
+		uint64_t failures = 0;
+		std::exception_ptr error;
+
+		std::atomic<uint64_t> nanos[stages] {};
+		std::atomic<size_t> jobs[stages] {};
+
+		// needs to be declared last so that it's destroyed (and drained) first
+		TaskPool pool;
+
+		/// Raises the number of stages the given chunk has to complete, and the number of stages its neighbours
+		/// have to complete so that it can, collects the entries whose target increased, requires the mutex to be held
+		void raise(glm::ivec3 pos, int target, std::vector<glm::ivec3>& raised);
+
+		/// Starts the next stage of the given chunk if it needs one and its neighbours are ready, requires the mutex to be held
+		void tryStart(glm::ivec3 pos);
+
+		/// Called by the job once a stage completes, stores the results and starts the stages that were waiting for it
+		void complete(glm::ivec3 pos, Chunk* chunk);
+
+		/// Called by the job if a stage throws, drops the partially generated chunk and fails all the pending requests
+		void fail(glm::ivec3 pos, Chunk* chunk, std::exception_ptr error);
+
+		/// Drops the least recently used entries that are not needed by any unfinished chunk, requires the mutex to be held
+		void prune();
+
+	public:
+
+		/// Creates a pipeline that keeps at most (around) the given number of partially generated chunks
+		GenerationPipeline(WorldGenerator& generator, size_t capacity, size_t threads = TaskPool::optimal());
+		~GenerationPipeline();
+
+		/// Generates the given chunk up to the final stage and returns it, blocks until it's done, safe to call from many threads,
+		/// if any stage throws in the meantime the error is rethrown here, the next call starts the generation again
+		Chunk* get(glm::ivec3 pos);
+
+		/// Returns the total time spent running the given stage, in milliseconds
+		double getStageTime(Stage stage) const;
+
+		/// Returns the number of times the given stage ran
+		size_t getStageJobs(Stage stage) const;
+
+		/// Returns the number of chunks (partially generated or not) currently kept
+		size_t size();
+
+};
@@ -2,13 +2,20 @@
 #include "raycast.hpp"
 
 Raycast::Raycast()
-: successful(false), hit(0), last(0) {}
+: type(MISS), hit(0), last(0) {}
 
 Raycast::Raycast(glm::ivec3 hit, glm::ivec3 last)
-: successful(true), hit(hit), last(last) {}
+: type(HIT), hit(hit), last(last) {}
+
+Raycast::Raycast(Type type, glm::ivec3 hit, glm::ivec3 last)
+: type(type), hit(hit), last(last) {}
 
 Raycast::operator bool() const {
-	return successful;
+	return type == HIT;
+}
+
+Raycast::Type Raycast::getType() const {
+	return type;
 }
 
 glm::ivec3 Raycast::getPos() const {
@@ -3,11 +3,27 @@
 #include "external.hpp"
 #include "util/type/direction.hpp"
 
+struct Ray {
+
+	glm::vec3 from;
+	glm::vec3 direction;
+	float distance;
+
+};
+
 class Raycast {
 
+	public:
+
+		enum Type : uint8_t {
+			MISS     = 0, // the ray reached its distance limit without hitting anything
+			HIT      = 1, // the ray hit a non-air block
+			UNLOADED = 2, // the ray entered a chunk that is not loaded
+		};
+
 	private:
 
-		bool successful;
+		Type type;
 		glm::ivec3 hit;
 		glm::ivec3 last;
 
@@ -15,9 +31,18 @@ class Raycast {
 
 		Raycast();
 		Raycast(glm::ivec3 hit, glm::ivec3 last);
+		Raycast(Type type, glm::ivec3 hit, glm::ivec3 last);
 
+		/// Returns true only if a block was hit
 		operator bool() const;
+
+		/// Returns the kind of result this raycast represents
+		Type getType() const;
+
+		/// The position of the hit block, or the first position in an unloaded chunk
 		glm::ivec3 getPos() const;
+
+		/// The last position before the hit (or unloaded) position
 		glm::ivec3 getTarget() const;
 
 };
@@ -0,0 +1,63 @@
+
+#include "cache.hpp"
+
+/*
+ * ChunkMeshCache
+ */
+
+void ChunkMeshCache::erase(decltype(entries)::iterator it) {
+	total -= it->second.bytes;
+	order.erase(it->second.order);
+	entries.erase(it);
+}
+
+void ChunkMeshCache::trim() {
+	while (total > budget && !order.empty()) {
+		erase(entries.find(order.back()));
+	}
+}
+
+ChunkMeshCache::ChunkMeshCache(size_t budget)
+: budget(budget) {}
+
+std::unique_ptr<ChunkPlaneMesh> ChunkMeshCache::take(glm::ivec3 pos) {
+	std::lock_guard lock {mutex};
+	auto it = entries.find(pos);
+
+	if (it == entries.end()) {
+		return std::make_unique<ChunkPlaneMesh>();
+	}
+
+	std::unique_ptr<ChunkPlaneMesh> mesh = std::move(it->second.mesh);
+	erase(it);
+
+	return mesh;
+}
+
+void ChunkMeshCache::put(glm::ivec3 pos, std::unique_ptr<ChunkPlaneMesh> mesh) {
+	const size_t bytes = sizeof(ChunkPlaneMesh) + mesh->bytes();
+
+	std::lock_guard lock {mutex};
+	auto it = entries.find(pos);
+
+	// two workers can mesh the same chunk at once, any of the results is
+	// fine to keep as each mesh knows which chunk versions it matches
+	if (it != entries.end()) {
+		erase(it);
+	}
+
+	order.push_front(pos);
+	entries.emplace(pos, Entry {order.begin(), std::move(mesh), bytes});
+	total += bytes;
+	trim();
+}
+
+size_t ChunkMeshCache::bytes() {
+	std::lock_guard lock {mutex};
+	return total;
+}
+
+size_t ChunkMeshCache::size() {
+	std::lock_guard lock {mutex};
+	return entries.size();
+}
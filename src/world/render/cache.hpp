@@ -0,0 +1,50 @@
+#pragma once
+
+#include "external.hpp"
+#include "mesher.hpp"
+
+/**
+ * Bounded LRU cache of the per-plane chunk meshes, lets the render pool remesh
+ * only the changed planes of recently meshed chunks. A mesh is taken out of the cache
+ * for the duration of the meshing, so no two workers ever share one.
+ */
+class ChunkMeshCache {
+
+	private:
+
+		struct Entry {
+			std::list<glm::ivec3>::iterator order;
+			std::unique_ptr<ChunkPlaneMesh> mesh;
+			size_t bytes;
+		};
+
+		std::mutex mutex;
+		size_t budget;
+		size_t total = 0;
+
+		std::list<glm::ivec3> order;
+		ankerl::unordered_dense::map<glm::ivec3, Entry> entries;
+
+		/// Removes the entry and updates the byte count, requires the mutex to be held
+		void erase(decltype(entries)::iterator it);
+
+		/// Removes the least recently used entries until the budget is met, requires the mutex to be held
+		void trim();
+
+	public:
+
+		ChunkMeshCache(size_t budget);
+
+		/// Removes the mesh of the given chunk from the cache and returns it, returns an empty mesh if it's not cached
+		std::unique_ptr<ChunkPlaneMesh> take(glm::ivec3 pos);
+
+		/// Puts the mesh of the given chunk back into the cache, replacing any other copy
+		void put(glm::ivec3 pos, std::unique_ptr<ChunkPlaneMesh> mesh);
+
+		/// Returns the number of bytes used by the cached meshes
+		size_t bytes();
+
+		/// Returns the number of cached meshes
+		size_t size();
+
+};
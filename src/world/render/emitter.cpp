@@ -24,6 +24,12 @@ void MeshEmitter::pushIndex(size_t index) {
 	vertices.push_back(vertices[back + index]);
 }
 
+void MeshEmitter::append(const MeshEmitter& other) {
+	vertices.insert(vertices.end(), other.vertices.begin(), other.vertices.end());
+	front = vertices.size();
+	back = front;
+}
+
 void MeshEmitter::clear() {
 	vertices.clear();
 	front = 0;
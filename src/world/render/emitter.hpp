@@ -2,7 +2,11 @@
 
 #include "external.hpp"
 #include "client/vertices.hpp"
-#include "buffer/buffer.hpp"
+
+// the headless build meshes chunks but never uploads them
+#if !defined(VLT3D_HEADLESS)
+#	include "buffer/buffer.hpp"
+#endif
 
 class MeshEmitter {
 
@@ -24,6 +28,9 @@ class MeshEmitter {
 		/// Emits a TerrainVertex from the previous triangle by its index
 		void pushIndex(size_t index);
 
+		/// Copies all the vertices of another emitter to the end of this one
+		void append(const MeshEmitter& other);
+
 	public:
 
 		/// Clears the internal buffers
@@ -82,6 +89,8 @@ class MeshEmitterSet {
 			return emitters[index];
 		}
 
+#if !defined(VLT3D_HEADLESS)
+
 	public:
 
 		void writeToBuffer(BasicBuffer& buffer, std::array<uint32_t, components>& region_begin, std::array<uint32_t, components>& region_count) const {
@@ -105,4 +114,6 @@ class MeshEmitterSet {
 
 		}
 
+#endif
+
 };
@@ -1,7 +1,7 @@
 
 #include "mesher.hpp"
-#include "renderer.hpp"
 #include "world/view.hpp"
+#include "util/thread/pool.hpp"
 
 /*
  * ChunkPlane
@@ -27,8 +27,14 @@ ChunkFaceBuffer::~ChunkFaceBuffer() {
 	delete[] this->buffer;
 }
 
-void ChunkFaceBuffer::clear(uint16_t empty) {
-	memset(this->buffer, empty, size * sizeof(ChunkPlane));
+void ChunkFaceBuffer::clear(const DirtySlices& slices, int level, uint16_t empty) {
+	for (int axis = 0; axis < 3; axis ++) {
+		for (int slice = 0; slice < (int) planes_along_axis; slice ++) {
+			if (slices.contains(level, axis, slice)) {
+				memset(&get(slice, axis * planes_along_axis * planes_per_axis), empty, planes_per_axis * sizeof(ChunkPlane));
+			}
+		}
+	}
 }
 
 ChunkPlane& ChunkFaceBuffer::getX(int x, int offset) {
@@ -56,97 +62,473 @@ BlockFaceView ChunkFaceBuffer::getBlockView(int x, int y, int z) {
 	return view;
 }
 
+/*
+ * ChunkMaskBuffer
+ */
+
+ChunkMaskBuffer::ChunkMaskBuffer() {
+	this->buffer = new Plane[size];
+}
+
+ChunkMaskBuffer::~ChunkMaskBuffer() {
+	delete[] this->buffer;
+}
+
+void ChunkMaskBuffer::clear(const DirtySlices& slices, int level) {
+	for (int direction = 0; direction < 6; direction ++) {
+		for (int slice = 0; slice < Chunk::size; slice ++) {
+			if (slices.contains(level, direction / 2, slice)) {
+				memset(&get(direction, slice), 0, sizeof(Plane));
+			}
+		}
+	}
+}
+
+ChunkMaskBuffer::Plane& ChunkMaskBuffer::get(int direction, int slice) {
+	return buffer[direction * Chunk::size + slice];
+}
+
+/*
+ * ChunkPlaneMesh
+ */
+
+glm::ivec3 ChunkPlaneMesh::offsetOf(int source) {
+	if (source == 0) {
+		return {0, 0, 0};
+	}
+
+	glm::ivec3 offset {0};
+	const int direction = source - 1;
+	offset[direction / 2] = (direction % 2) ? 1 : -1;
+
+	return offset;
+}
+
+DirtySlices ChunkPlaneMesh::getChanges(const WorldView& view) const {
+	const glm::ivec3 origin = view.origin();
+	DirtySlices changes;
+
+	for (int source = 0; source < sources; source ++) {
+		const glm::ivec3 pos = origin + offsetOf(source);
+		const std::shared_ptr<Chunk>& chunk = view.getSource(pos.x, pos.y, pos.z);
+		const uint64_t version = view.getVersion(pos.x, pos.y, pos.z);
+
+		// we can only compare with the same chunk object, and only with an older version of it,
+		// the mesh can be newer than the view if some other worker meshed the chunk in the meantime
+		DirtySlices slices;
+		const bool known = chunk && chunks[source].lock() == chunk && versions[source] <= version && chunk->getChanges(versions[source], slices);
+
+		if (source == 0) {
+			if (!known) {
+				return DirtySlices::all();
+			}
+
+			changes = slices;
+			continue;
+		}
+
+		// only our border slice faces depend on the neighbour, and only on its own border
+		const int direction = source - 1;
+		const int axis = direction / 2;
+		const bool positive = direction % 2;
+
+		for (int level = 0; level < DirtySlices::levels; level ++) {
+			if (!known || slices.contains(level, axis, positive ? 0 : Chunk::mask)) {
+				changes.add(level, axis, positive ? Chunk::mask : 0);
+
+				// the side sprites of our top blocks depend on the block above them, so the side faces
+				// in the X and Z slices below any changed column (or all of them, if we can't tell) change too
+				if (direction == DirectionIndex::UP) {
+					changes.masks[level][DirectionIndex::X] |= known ? slices.masks[level][DirectionIndex::X] : ~uint32_t {0};
+					changes.masks[level][DirectionIndex::Z] |= known ? slices.masks[level][DirectionIndex::Z] : ~uint32_t {0};
+				}
+			}
+		}
+	}
+
+	return changes;
+}
+
+void ChunkPlaneMesh::setSource(const WorldView& view) {
+	const glm::ivec3 origin = view.origin();
+
+	for (int source = 0; source < sources; source ++) {
+		const glm::ivec3 pos = origin + offsetOf(source);
+
+		chunks[source] = view.getSource(pos.x, pos.y, pos.z);
+		versions[source] = view.getVersion(pos.x, pos.y, pos.z);
+	}
+}
+
+MeshEmitter& ChunkPlaneMesh::get(int level, int direction, int slice) {
+	return planes[level][direction][slice];
+}
+
+void ChunkPlaneMesh::writeTo(MeshEmitterSet& emitters) const {
+	emitters.clear();
+
+	for (int direction = 0; direction < directions; direction ++) {
+		for (int slice = 0; slice < Chunk::size; slice ++) {
+			emitters.get(direction).append(planes[0][direction][slice]);
+			emitters.get(MeshEmitterSet::LOD_2).append(planes[1][direction][slice]);
+		}
+	}
+}
+
+size_t ChunkPlaneMesh::bytes() const {
+	size_t total = 0;
+
+	for (const auto& level : planes) {
+		for (const auto& direction : level) {
+			for (const MeshEmitter& plane : direction) {
+				total += plane.getVertexData().capacity() * sizeof(VertexTerrain);
+			}
+		}
+	}
+
+	return total;
+}
+
 /*
  * GreedyMesher
  */
 
-void GreedyMesher::emitLevel(ChunkFaceBuffer& buffer, WorldView& view, const SpriteArray& array, int level) {
+/// Returns the column occupancy mask as seen at the given detail level, where each sampled block stands for the 2^level blocks above it
+static uint32_t sampleColumn(uint32_t column, int level) {
+	if (level == 0) {
+		return column;
+	}
 
-	buffer.clear(GreedyMesher::empty_tile);
+	const int step = 1 << level;
+	const uint32_t run = (uint32_t {1} << step) - 1;
+	uint32_t sampled = 0;
 
-	int gray_sprite = array.getSpriteIndex("gray");
-	int clay_sprite = array.getSpriteIndex("clay");
-	int moss_sprite = array.getSpriteIndex("moss");
-	int side_sprite = array.getSpriteIndex("side");
+	for (int y = 0; y < Chunk::size; y += step) {
+		if (column & (uint32_t {1} << y)) {
+			sampled |= run << y;
+		}
+	}
 
-	int mask = 0;
+	return sampled;
+}
 
-	for (int i = 1; i < level; i <<= 1) {
-		mask |= i;
+/// Transposes a 32x32 bit matrix, so bit N of row M ends up as bit M of row N
+static void transpose(const uint32_t input[32], uint32_t output[32]) {
+	std::copy_n(input, 32, output);
+	uint32_t mask = 0x0000FFFF;
+
+	// swap the off-diagonal blocks, first of 16x16 bits, then of 8x8 bits and so on
+	for (int j = 16; j != 0; j >>= 1, mask ^= mask << j) {
+		for (int k = 0; k < 32; k = (k + j + 1) & ~j) {
+			const uint32_t swapped = ((output[k] >> j) ^ output[k + j]) & mask;
+			output[k + j] ^= swapped;
+			output[k] ^= swapped << j;
+		}
 	}
+}
+
+static_assert(Chunk::size == 32, "The binary mesher expects the chunk rows to fit exactly into 32 bit masks");
+
+void GreedyMesher::emitPlane(MeshEmitter& emitter, int direction, glm::ivec3 chunk, int slice, ChunkFaceBuffer& buffer) {
+	switch (direction) {
+		case DirectionIndex::WEST: return emitPlane<Normal::WEST>(emitter, chunk, slice, buffer.getX(slice, 0));
+		case DirectionIndex::EAST: return emitPlane<Normal::EAST>(emitter, chunk, slice, buffer.getX(slice, 1));
+		case DirectionIndex::DOWN: return emitPlane<Normal::DOWN>(emitter, chunk, slice, buffer.getY(slice, 0));
+		case DirectionIndex::UP: return emitPlane<Normal::UP>(emitter, chunk, slice, buffer.getY(slice, 1));
+		case DirectionIndex::NORTH: return emitPlane<Normal::NORTH>(emitter, chunk, slice, buffer.getZ(slice, 0));
+		case DirectionIndex::SOUTH: return emitPlane<Normal::SOUTH>(emitter, chunk, slice, buffer.getZ(slice, 1));
+	}
+}
+
+void GreedyMesher::emitPlane(MeshEmitter& emitter, int direction, glm::ivec3 chunk, int slice, ChunkMaskBuffer& buffer) {
+	const ChunkMaskBuffer::Plane& plane = buffer.get(direction, slice);
+
+	switch (direction) {
+		case DirectionIndex::WEST: return emitPlane<Normal::WEST>(emitter, chunk, slice, plane, buffer.sprites);
+		case DirectionIndex::EAST: return emitPlane<Normal::EAST>(emitter, chunk, slice, plane, buffer.sprites);
+		case DirectionIndex::DOWN: return emitPlane<Normal::DOWN>(emitter, chunk, slice, plane, buffer.sprites);
+		case DirectionIndex::UP: return emitPlane<Normal::UP>(emitter, chunk, slice, plane, buffer.sprites);
+		case DirectionIndex::NORTH: return emitPlane<Normal::NORTH>(emitter, chunk, slice, plane, buffer.sprites);
+		case DirectionIndex::SOUTH: return emitPlane<Normal::SOUTH>(emitter, chunk, slice, plane, buffer.sprites);
+	}
+}
+
+void GreedyMesher::emitLevel(ChunkFaceBuffer& buffer, WorldView& view, const TerrainSprites& sprites, int level, const DirtySlices& slices) {
+
+	buffer.clear(slices, level, GreedyMesher::empty_tile);
+
+	int mask = (1 << level) - 1;
 
 	const auto fetchBlock = [mask = ~mask, &view] (int x, int y, int z) -> Block {
 		return view.getBlock(x & mask, y & mask, z & mask);
 	};
 
+	// neighbour checks only need to know about air so use the occupancy masks
+	const auto fetchAir = [mask = ~mask, &view] (int x, int y, int z) -> bool {
+		return view.isAir(x & mask, y & mask, z & mask);
+	};
+
 	glm::ivec3 offset = view.origin() * Chunk::size;
 
 	for (int z = 0; z < Chunk::size; z++) {
+		const bool dirty_z = slices.contains(level, DirectionIndex::Z, z);
+
 		for (int y = 0; y < Chunk::size; y++) {
+			const bool dirty_y = slices.contains(level, DirectionIndex::Y, y);
+
 			for (int x = 0; x < Chunk::size; x++) {
+				const bool dirty_x = slices.contains(level, DirectionIndex::X, x);
+
+				// the faces only need to be written into the planes that will be meshed
+				if (!dirty_x && !dirty_y && !dirty_z) {
+					continue;
+				}
 
 				glm::ivec3 pos = offset + glm::ivec3 {x, y, z};
-				Block block = fetchBlock(pos.x, pos.y, pos.z);
 
-				if (block.isAir()) {
+				if (fetchAir(pos.x, pos.y, pos.z)) {
 					continue;
 				}
 
 				BlockFaceView faces = buffer.getBlockView(x, y, z);
 
-				int top = (block.block_type % 2 == 1) ? gray_sprite : clay_sprite;
-				int side = top;
-				int bottom = top;
+				bool west = dirty_x && fetchAir(pos.x - 1, pos.y, pos.z);
+				bool east = dirty_x && fetchAir(pos.x + 1, pos.y, pos.z);
+				bool down = dirty_y && fetchAir(pos.x, pos.y - 1, pos.z);
+				bool up = fetchAir(pos.x, pos.y + 1, pos.z);
+				bool north = dirty_z && fetchAir(pos.x, pos.y, pos.z - 1);
+				bool south = dirty_z && fetchAir(pos.x, pos.y, pos.z + 1);
+
+				int top = culled_tile;
+				int side = culled_tile;
+				int bottom = culled_tile;
+
+				// the sprites are only needed if some face is visible, which most blocks don't have
+				if (west || east || down || (dirty_y && up) || north || south) {
+					Block block = fetchBlock(pos.x, pos.y, pos.z);
+
+					top = (block.block_type % 2 == 1) ? sprites.gray : sprites.clay;
+					side = top;
+					bottom = top;
+
+					if (bottom == sprites.clay && up) {
+						side = sprites.side;
+						top = sprites.moss;
+					}
+				}
 
-				bool west = fetchBlock(pos.x - 1, pos.y, pos.z).isAir();
-				bool east = fetchBlock(pos.x + 1, pos.y, pos.z).isAir();
-				bool down = fetchBlock(pos.x, pos.y - 1, pos.z).isAir();
-				bool up = fetchBlock(pos.x, pos.y + 1, pos.z).isAir();
-				bool north = fetchBlock(pos.x, pos.y, pos.z - 1).isAir();
-				bool south = fetchBlock(pos.x, pos.y, pos.z + 1).isAir();
+				if (dirty_x) {
+					*faces.west = west ? side : culled_tile;
+					*faces.east = east ? side : culled_tile;
+				}
 
-				if (bottom == clay_sprite && up) {
-					side = side_sprite;
-					top = moss_sprite;
+				if (dirty_y) {
+					*faces.down = down ? bottom : culled_tile;
+					*faces.up = up ? top : culled_tile;
 				}
 
-				*faces.west = west ? side : culled_tile;
-				*faces.east = east ? side : culled_tile;
-				*faces.down = down ? bottom : culled_tile;
-				*faces.up = up ? top : culled_tile;
-				*faces.north = north ? side : culled_tile;
-				*faces.south = south ? side : culled_tile;
+				if (dirty_z) {
+					*faces.north = north ? side : culled_tile;
+					*faces.south = south ? side : culled_tile;
+				}
 			}
 		}
 	}
 
 }
 
-void GreedyMesher::emitChunk(MeshEmitterSet& emitters, ChunkFaceBuffer& buffer, WorldView& view, const SpriteArray& array) {
+void GreedyMesher::emitLevel(ChunkMaskBuffer& buffer, WorldView& view, const TerrainSprites& sprites, int level, const DirtySlices& slices) {
+
+	buffer.clear(slices, level);
+	buffer.sprites = sprites;
+
+	int mask = (1 << level) - 1;
+
+	const auto fetchBlock = [mask = ~mask, &view] (int x, int y, int z) -> Block {
+		return view.getBlock(x & mask, y & mask, z & mask);
+	};
+
+	const auto fetchAir = [mask = ~mask, &view] (int x, int y, int z) -> bool {
+		return view.isAir(x & mask, y & mask, z & mask);
+	};
+
+	// the occupancy of the whole vertical column at the given horizontal position, it can be in one of the side neighbours
+	const auto fetchColumn = [mask = ~mask, level, &view] (int x, int y, int z) -> uint32_t {
+		x &= mask;
+		z &= mask;
+
+		const ChunkData* chunk = view.getChunk(x >> Chunk::bits, y >> Chunk::bits, z >> Chunk::bits);
+		return sampleColumn(chunk->getColumnMask(x & Chunk::mask, z & Chunk::mask), level);
+	};
 
-	emitLevel(buffer, view, array, 1);
 	glm::ivec3 offset = view.origin() * Chunk::size;
 
-	// this can be done on 3 threads if we need more speed
-	for (int slice = 0; slice < Chunk::size; slice ++) {
-		emitPlane<Normal::WEST>(emitters.get(DirectionIndex::WEST), offset, slice, buffer.getX(slice, 0));
-		emitPlane<Normal::EAST>(emitters.get(DirectionIndex::EAST), offset, slice, buffer.getX(slice, 1));
-		emitPlane<Normal::DOWN>(emitters.get(DirectionIndex::DOWN), offset, slice, buffer.getY(slice, 0));
-		emitPlane<Normal::UP>(emitters.get(DirectionIndex::UP), offset, slice, buffer.getY(slice, 1));
-		emitPlane<Normal::NORTH>(emitters.get(DirectionIndex::NORTH), offset, slice, buffer.getZ(slice, 0));
-		emitPlane<Normal::SOUTH>(emitters.get(DirectionIndex::SOUTH), offset, slice, buffer.getZ(slice, 1));
+	// the planes along X and Z only need the columns in their own slices, but the ones along Y need all of them
+	const bool dirty_y = slices.contains(level, DirectionIndex::Y);
+	const bool dirty_z = slices.contains(level, DirectionIndex::Z);
+
+	for (int x = 0; x < Chunk::size; x ++) {
+		const bool dirty_x = slices.contains(level, DirectionIndex::X, x);
+
+		if (!dirty_x && !dirty_y && !dirty_z) {
+			continue;
+		}
+
+		// the face masks of each direction and kind for all the columns at this x, bit N is the face at y=N
+		uint32_t faces[6][ChunkMaskBuffer::kinds][Chunk::size] {};
+
+		for (int z = 0; z < Chunk::size; z ++) {
+			glm::ivec3 pos = offset + glm::ivec3 {x, 0, z};
+			uint32_t column = fetchColumn(pos.x, pos.y, pos.z);
+
+			if (column == 0) {
+				continue;
+			}
+
+			// the blocks right above and below the column are in the neighbouring chunks
+			const uint32_t above = fetchAir(pos.x, pos.y + Chunk::size, pos.z) ? 0 : 1;
+			const uint32_t below = fetchAir(pos.x, pos.y - 1, pos.z) ? 0 : 1;
+
+			const uint32_t up_air = ~((column >> 1) | (above << Chunk::mask));
+			const uint32_t down_air = ~((column << 1) | below);
+
+			uint32_t visible[6];
+			visible[DirectionIndex::WEST] = column & ~fetchColumn(pos.x - 1, pos.y, pos.z);
+			visible[DirectionIndex::EAST] = column & ~fetchColumn(pos.x + 1, pos.y, pos.z);
+			visible[DirectionIndex::DOWN] = column & down_air;
+			visible[DirectionIndex::UP] = column & up_air;
+			visible[DirectionIndex::NORTH] = column & ~fetchColumn(pos.x, pos.y, pos.z - 1);
+			visible[DirectionIndex::SOUTH] = column & ~fetchColumn(pos.x, pos.y, pos.z + 1);
+
+			uint32_t any = 0;
+
+			for (uint32_t bits : visible) {
+				any |= bits;
+			}
+
+			// the blocks are only read for the visible faces, this is the same sprite selection as in the face buffer path
+			uint32_t gray = 0;
+
+			for (uint32_t bits = any; bits != 0; bits &= bits - 1) {
+				const int y = std::countr_zero(bits);
+
+				if (fetchBlock(pos.x, pos.y + y, pos.z).block_type % 2 == 1) {
+					gray |= uint32_t {1} << y;
+				}
+			}
+
+			for (int direction = 0; direction < 6; direction ++) {
+				uint32_t (&kinds)[ChunkMaskBuffer::kinds][Chunk::size] = faces[direction];
+				const uint32_t clay = visible[direction] & ~gray;
+
+				kinds[ChunkMaskBuffer::gray][z] = visible[direction] & gray;
+				kinds[ChunkMaskBuffer::culled][z] = column & ~visible[direction];
+
+				if (direction == DirectionIndex::UP) {
+					kinds[ChunkMaskBuffer::moss][z] = clay;
+				} else if (direction == DirectionIndex::DOWN) {
+					kinds[ChunkMaskBuffer::clay][z] = clay;
+				} else {
+					kinds[ChunkMaskBuffer::side][z] = clay & up_air;
+					kinds[ChunkMaskBuffer::clay][z] = clay & ~up_air;
+				}
+			}
+		}
+
+		// now move the masks into the planes, the masks need to be transposed for
+		// the planes along X and Y, as the rows of the planes go across the columns
+		for (int kind = 0; kind < ChunkMaskBuffer::kinds; kind ++) {
+			for (int direction : {DirectionIndex::NORTH, DirectionIndex::SOUTH}) {
+				for (int z = 0; z < Chunk::size; z ++) {
+					if (slices.contains(level, DirectionIndex::Z, z)) {
+						buffer.get(direction, z).rows[kind][x] = faces[direction][kind][z];
+					}
+				}
+			}
+
+			if (dirty_x) {
+				for (int direction : {DirectionIndex::WEST, DirectionIndex::EAST}) {
+					transpose(faces[direction][kind], buffer.get(direction, x).rows[kind]);
+				}
+			}
+
+			if (dirty_y) {
+				for (int direction : {DirectionIndex::DOWN, DirectionIndex::UP}) {
+					uint32_t rows[Chunk::size];
+					transpose(faces[direction][kind], rows);
+
+					for (int y = 0; y < Chunk::size; y ++) {
+						if (slices.contains(level, DirectionIndex::Y, y)) {
+							buffer.get(direction, y).rows[kind][x] = rows[y];
+						}
+					}
+				}
+			}
+		}
 	}
 
-	emitLevel(buffer, view, array, 2);
+}
+
+template <typename Buffer>
+void GreedyMesher::emitLevels(Buffer& buffer, WorldView& view, const TerrainSprites& sprites, ChunkPlaneMesh& planes, TaskPool* pool) {
+
+	const DirtySlices slices = planes.getChanges(view);
+	const glm::ivec3 offset = view.origin() * Chunk::size;
 
-	// this can be done on 3 threads if we need more speed
-	for (int slice = 0; slice < Chunk::size; slice ++) {
-		emitPlane<Normal::WEST>(emitters.get(MeshEmitterSet::LOD_2), offset, slice, buffer.getX(slice, 0));
-		emitPlane<Normal::EAST>(emitters.get(MeshEmitterSet::LOD_2), offset, slice, buffer.getX(slice, 1));
-		emitPlane<Normal::DOWN>(emitters.get(MeshEmitterSet::LOD_2), offset, slice, buffer.getY(slice, 0));
-		emitPlane<Normal::UP>(emitters.get(MeshEmitterSet::LOD_2), offset, slice, buffer.getY(slice, 1));
-		emitPlane<Normal::NORTH>(emitters.get(MeshEmitterSet::LOD_2), offset, slice, buffer.getZ(slice, 0));
-		emitPlane<Normal::SOUTH>(emitters.get(MeshEmitterSet::LOD_2), offset, slice, buffer.getZ(slice, 1));
+	for (int level = 0; level < DirtySlices::levels; level ++) {
+
+		// most edits don't touch any block that is sampled by the lower detail levels,
+		// and changes to neighbours away from our border don't touch anything at all
+		if (!slices.contains(level, DirectionIndex::X) && !slices.contains(level, DirectionIndex::Y) && !slices.contains(level, DirectionIndex::Z)) {
+			continue;
+		}
+
+		emitLevel(buffer, view, sprites, level, slices);
+
+		// the planes only read the buffer, and each of them is emitted into its own emitter
+		const auto emitAxis = [&] (int axis) {
+			for (int direction = axis * 2; direction < axis * 2 + 2; direction ++) {
+				for (int slice = 0; slice < Chunk::size; slice ++) {
+					if (slices.contains(level, axis, slice)) {
+						MeshEmitter& emitter = planes.get(level, direction, slice);
+
+						emitter.clear();
+						emitPlane(emitter, direction, offset, slice, buffer);
+					}
+				}
+			}
+		};
+
+		if (!pool) {
+			for (int axis = 0; axis < 3; axis ++) {
+				emitAxis(axis);
+			}
+
+			continue;
+		}
+
+		std::future<bool> futures[] = {
+			pool->defer([&] () { emitAxis(DirectionIndex::Y); return true; }),
+			pool->defer([&] () { emitAxis(DirectionIndex::Z); return true; })
+		};
+
+		emitAxis(DirectionIndex::X);
+
+		for (auto& future : futures) {
+			future.get();
+		}
 	}
 
-}
\ No newline at end of file
+	planes.setSource(view);
+
+}
+
+void GreedyMesher::emitChunk(MeshEmitterSet& emitters, ChunkFaceBuffer& buffer, WorldView& view, const TerrainSprites& sprites, ChunkPlaneMesh& planes, TaskPool* pool) {
+	emitLevels(buffer, view, sprites, planes, pool);
+	planes.writeTo(emitters);
+}
+
+void GreedyMesher::emitChunk(MeshEmitterSet& emitters, ChunkMaskBuffer& buffer, WorldView& view, const TerrainSprites& sprites, ChunkPlaneMesh& planes, TaskPool* pool) {
+	emitLevels(buffer, view, sprites, planes, pool);
+	planes.writeTo(emitters);
+}
@@ -6,8 +6,19 @@
 #include "buffer/sprites.hpp"
 #include "emitter.hpp"
 
-class SpriteArray;
 class WorldView;
+class TaskPool;
+
+/**
+ * The sprite indices used for the block faces, looked up in the SpriteArray by the caller,
+ * this way the mesher doesn't depend on the (GPU backed) sprite array and can run headless
+ */
+struct TerrainSprites {
+	int gray;
+	int clay;
+	int moss;
+	int side;
+};
 
 struct BlockFaceView {
 
@@ -49,7 +60,8 @@ class ChunkFaceBuffer {
 		ChunkFaceBuffer();
 		~ChunkFaceBuffer();
 
-		void clear(uint16_t empty);
+		/// Fills both planes of each of the given slices with the given value
+		void clear(const DirtySlices& slices, int level, uint16_t empty);
 
 		ChunkPlane& getX(int x, int offset);
 		ChunkPlane& getY(int y, int offset);
@@ -59,6 +71,91 @@ class ChunkFaceBuffer {
 
 };
 
+/**
+ * Bit mask planes used by the binary meshing path, every plane has a set of row masks for each of the
+ * face kinds - one for each of the TerrainSprites and one for the culled faces (the faces of blocks covered on
+ * that side), bit N of row M is set if the face at alpha=M, beta=N is of that kind, the same layout as in ChunkPlane.
+ */
+class ChunkMaskBuffer {
+
+	public:
+
+		// the kinds of faces, the sprites are in the same order as in TerrainSprites
+		static constexpr int gray = 0;
+		static constexpr int clay = 1;
+		static constexpr int moss = 2;
+		static constexpr int side = 3;
+		static constexpr int culled = 4;
+		static constexpr int kinds = 5;
+
+		struct Plane {
+			uint32_t rows[kinds][Chunk::size];
+		};
+
+	private:
+
+		static constexpr size_t size = 6 /* directions */ * Chunk::size;
+
+		Plane* buffer = nullptr;
+
+	public:
+
+		// the sprites the face kinds stand for, set when the planes are written
+		TerrainSprites sprites {};
+
+		ChunkMaskBuffer();
+		~ChunkMaskBuffer();
+
+		/// Clears all the planes of each of the given slices
+		void clear(const DirtySlices& slices, int level);
+
+		/// Returns the plane of the given direction
+		Plane& get(int direction, int slice);
+
+};
+
+/**
+ * The mesh of a single chunk kept split into planes, each plane (of each direction and detail level)
+ * is a separate emitter, so that after an edit the mesher can emit only the affected planes again and
+ * join them with the unchanged ones. It also remembers the versions of the chunks it was meshed from,
+ * so that it can tell which of its planes are out of date.
+ */
+class ChunkPlaneMesh {
+
+	private:
+
+		static constexpr int directions = 6;
+
+		// the center chunk and then its face neighbours in the DirectionIndex order
+		static constexpr int sources = 1 + directions;
+
+		MeshEmitter planes[DirtySlices::levels][directions][Chunk::size];
+		std::weak_ptr<Chunk> chunks[sources];
+		uint64_t versions[sources] {};
+
+		/// Returns the position of the given source chunk relative to the origin
+		static glm::ivec3 offsetOf(int source);
+
+	public:
+
+		/// Returns the slices that need to be emitted again for this mesh to match the given captured view,
+		/// this will be all of them if the mesh is empty or was created from a different chunk
+		DirtySlices getChanges(const WorldView& view) const;
+
+		/// Remembers the chunk versions of the given captured view as the ones this mesh matches
+		void setSource(const WorldView& view);
+
+		/// Returns the emitter of a single plane
+		MeshEmitter& get(int level, int direction, int slice);
+
+		/// Joins all the planes into the given emitter set, replacing its content
+		void writeTo(MeshEmitterSet& emitters) const;
+
+		/// Returns the number of heap bytes used by this mesh
+		size_t bytes() const;
+
+};
+
 /**
  * This class is a container for all the greedy meshing machinery
  * the general walkthrough of the process look like this:
@@ -73,6 +170,15 @@ class ChunkFaceBuffer {
  * Then, in `emitChunk`, for each 2D chunk slice (plane) (Chunk::size per direction)
  * the `emitPlane` is invoked. This is the method that actually performs the greedy
  * meshing of the 2D data.
+ *
+ * <p>
+ * The result is kept in a `ChunkPlaneMesh`, when it's given back for the same chunk later
+ * only the slices that could have changed since then go through the steps above.
+ *
+ * <p>
+ * There is also a binary path, selected by passing a `ChunkMaskBuffer` in place of the `ChunkFaceBuffer`,
+ * it follows the same steps but with planes of bit masks (one per face sprite) in place of the planes
+ * of sprite indices, it's the one used by the game, the other one is kept as the reference.
  */
 class GreedyMesher {
 
@@ -426,13 +532,87 @@ class GreedyMesher {
 			});
 		}
 
+		/**
+		 * Greedily meshes one plane of the given direction from the face buffer
+		 */
+		static void emitPlane(MeshEmitter& emitter, int direction, glm::ivec3 chunk, int slice, ChunkFaceBuffer& buffer);
+
+		/**
+		 * Internal method used by the binary path of `emitChunk`, greedily meshes a single plane of face masks,
+		 * one sprite at a time, a quad starts at the lowest visible face of a row (found with count-trailing-zeros), grows
+		 * along the row and then over the following rows, it can also grow over the culled faces (they are never seen)
+		 * as long as it starts and ends on a visible one, the same as the `greedier_rows` and `greedier_merge` modes do
+		 */
+		template <Normal normal>
+		static void emitPlane(MeshEmitter& emitter, glm::ivec3 chunk, int slice, const ChunkMaskBuffer::Plane& plane, const TerrainSprites& sprites) {
+			const BakedSprite identity = BakedSprite::identity();
+			const int indices[] = {sprites.gray, sprites.clay, sprites.moss, sprites.side};
+			const uint32_t* culled = plane.rows[ChunkMaskBuffer::culled];
+
+			for (int kind = 0; kind < ChunkMaskBuffer::culled; kind ++) {
+
+				// the faces not yet covered by any quad
+				uint32_t rows[Chunk::size];
+				std::copy_n(plane.rows[kind], Chunk::size, rows);
+
+				for (int a = 0; a < Chunk::size; a ++) {
+					while (rows[a] != 0) {
+						const int start = std::countr_zero(rows[a]);
+
+						// grow over the visible and culled faces, then shrink back to the last visible one
+						const int reach = std::countr_zero(~((rows[a] | culled[a]) >> start));
+						uint32_t run = (~uint32_t {0} >> (Chunk::size - reach)) << start;
+
+						const int end = Chunk::size - std::countl_zero(rows[a] & run);
+						run = (~uint32_t {0} >> (Chunk::size - (end - start))) << start;
+
+						// same for the rows, the quad must not end on a row with only the culled faces
+						int extend = 1;
+
+						for (int next = a + 1; next < Chunk::size && ((rows[next] | culled[next]) & run) == run; next ++) {
+							if (rows[next] & run) {
+								extend = next - a + 1;
+							}
+						}
+
+						for (int i = a; i < a + extend; i ++) {
+							rows[i] &= ~run;
+						}
+
+						emitQuad<normal>(emitter, chunk.x, chunk.y, chunk.z, slice, a, start, extend, end - start, indices[kind], identity);
+					}
+				}
+			}
+		}
+
+		/**
+		 * Greedily meshes one plane of the given direction from the mask buffer
+		 */
+		static void emitPlane(MeshEmitter& emitter, int direction, glm::ivec3 chunk, int slice, ChunkMaskBuffer& buffer);
+
 	private:
 
 		/**
-		 * Imprints the sprite faces into the passed ChunkFaceBuffer
-		 * at the given detail level for later used during meshing.
+		 * Imprints the sprite faces into the passed ChunkFaceBuffer at the given detail level (where
+		 * only every 2^level-th block is sampled) for later used during meshing, only the planes
+		 * of the slices marked at this level are written, the rest of the buffer is left as-is.
+		 */
+		static void emitLevel(ChunkFaceBuffer& buffer, WorldView& view, const TerrainSprites& sprites, int level, const DirtySlices& slices);
+
+		/**
+		 * Binary counterpart of the method above, writes the face masks of the slices marked at the given level into
+		 * the passed ChunkMaskBuffer. The visibility is computed for whole vertical columns at once from the chunk occupancy
+		 * masks (shifted for the faces above and below, and combined with the neighbouring columns for the faces on the
+		 * sides), and the blocks are only read for the visible faces, to find out their sprites.
 		 */
-		static void emitLevel(ChunkFaceBuffer& buffer, WorldView& view, const SpriteArray& array, int level);
+		static void emitLevel(ChunkMaskBuffer& buffer, WorldView& view, const TerrainSprites& sprites, int level, const DirtySlices& slices);
+
+		/**
+		 * Emits the slices that changed since the plane mesh was last updated, using the given face buffer,
+		 * if a pool is given the planes of the Y and Z axes are meshed on it while the calling thread meshes the X axis
+		 */
+		template <typename Buffer>
+		static void emitLevels(Buffer& buffer, WorldView& view, const TerrainSprites& sprites, ChunkPlaneMesh& planes, TaskPool* pool);
 
 	public:
 
@@ -440,13 +620,31 @@ class GreedyMesher {
 		 * Emits the chunk mesh into the given buffer, this method will first iterate the chunk
 		 * block by block and add all block face sprites into the given ChunkFaceBuffer, after that
 		 * is done it will iterate that buffer plane by plane and greedily mesh each chunk slice.
+		 * Only the slices that changed since the plane mesh was last updated are processed.
+		 *
+		 * @param mesh the buffer for the resulting chunk geometry
+		 * @param buffer a temporary chunk buffer used during the meshing
+		 * @param view access to surrounding chunks
+		 * @param sprites the sprite indices of the block faces
+		 * @param planes the previous mesh of this chunk (or an empty one), updated to match the view
+		 * @param pool if given, the planes of the different axes are meshed in parallel using this pool,
+		 *             the pool must not be one that could be waiting for this call, or it may deadlock
+		 */
+		static void emitChunk(MeshEmitterSet& emitters, ChunkFaceBuffer& buffer, WorldView& view, const TerrainSprites& sprites, ChunkPlaneMesh& planes, TaskPool* pool = nullptr);
+
+		/**
+		 * Same as the method above, but meshes the chunk using the bit masks of the visible faces in place of the
+		 * face sprite planes, the resulting mesh covers the same faces with the same sprites (but can use a different
+		 * set of quads to do that), the method above is kept as the reference implementation of the mesher.
 		 *
 		 * @param mesh the buffer for the resulting chunk geometry
 		 * @param buffer a temporary chunk buffer used during the meshing
 		 * @param view access to surrounding chunks
-		 * @param array the block sprite storage
+		 * @param sprites the sprite indices of the block faces
+		 * @param planes the previous mesh of this chunk (or an empty one), updated to match the view
+		 * @param pool if given, the planes of the different axes are meshed in parallel using this pool
 		 */
-		static void emitChunk(MeshEmitterSet& emitters, ChunkFaceBuffer& buffer, WorldView& view, const SpriteArray& array);
+		static void emitChunk(MeshEmitterSet& emitters, ChunkMaskBuffer& buffer, WorldView& view, const TerrainSprites& sprites, ChunkPlaneMesh& planes, TaskPool* pool = nullptr);
 
 };
 
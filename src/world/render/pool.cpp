@@ -7,13 +7,14 @@
 #include "renderer.hpp"
 #include "mesher.hpp"
 #include "world/view.hpp"
+#include "buffer/array.hpp"
 
 /*
  * ChunkRenderPool::UpdateRequest
  */
 
-ChunkRenderPool::UpdateRequest::UpdateRequest(WorldView&& view, uint64_t stamp)
-: view(view), timer(), stamp(stamp) {}
+ChunkRenderPool::UpdateRequest::UpdateRequest(WorldView&& view, uint64_t stamp, bool important)
+: view(view), timer(), stamp(stamp), important(important) {}
 
 glm::ivec3 ChunkRenderPool::UpdateRequest::origin() const {
 	double millis = timer.milliseconds();
@@ -33,6 +34,10 @@ uint64_t ChunkRenderPool::UpdateRequest::getStamp() const {
 	return stamp;
 }
 
+bool ChunkRenderPool::UpdateRequest::isImportant() const {
+	return important;
+}
+
 /*
  * ChunkRenderPool
  */
@@ -59,9 +64,25 @@ bool ChunkRenderPool::empty() {
 	return set.empty();
 }
 
-void ChunkRenderPool::emitChunk(MeshEmitterSet& mesh, ChunkFaceBuffer& buffer, WorldView& view, uint64_t stamp) {
-	mesh.clear();
-	GreedyMesher::emitChunk(mesh, buffer, view, system.assets.state->array);
+void ChunkRenderPool::emitChunk(MeshEmitterSet& mesh, ChunkMaskBuffer& buffer, WorldView& view, uint64_t stamp, bool important) {
+	const SpriteArray& array = system.assets.state->array;
+
+	// looked up every time, as the resources (and so the sprite array) can be reloaded
+	TerrainSprites sprites {};
+	sprites.gray = array.getSpriteIndex("gray");
+	sprites.clay = array.getSpriteIndex("clay");
+	sprites.moss = array.getSpriteIndex("moss");
+	sprites.side = array.getSpriteIndex("side");
+
+	std::unique_ptr<ChunkPlaneMesh> planes = cache.take(view.origin());
+	GreedyMesher::emitChunk(mesh, buffer, view, sprites, *planes, important ? &plane_pool : nullptr);
+	cache.put(view.origin(), std::move(planes));
+
+	// the chunk was modified while we were meshing it, that modification
+	// also requested a remesh, so there is no point in uploading this one
+	if (view.stale()) {
+		return;
+	}
 
 	if (!mesh.empty()) {
 		renderer.submitChunk(view.origin(), mesh, stamp);
@@ -73,7 +94,7 @@ void ChunkRenderPool::run() {
 	bool got = false;
 	UpdateRequest request;
 	MeshEmitterSet emitters {1024};
-	ChunkFaceBuffer buffer;
+	ChunkMaskBuffer buffer;
 
 	while (true) {
 		{
@@ -95,8 +116,12 @@ void ChunkRenderPool::run() {
 
 		WorldView view = request.unpack();
 
-		if (!view.getOriginChunk()->empty()) {
-			emitChunk(emitters, buffer, view, request.getStamp());
+		// from now on nothing we read can change under us
+		view.capture();
+
+		// empty chunks and solid chunks surrounded by solid chunks have no faces
+		if (!view.getOriginChunk()->empty() && !view.enclosed()) {
+			emitChunk(emitters, buffer, view, request.getStamp(), request.isImportant());
 		}
 	}
 }
@@ -118,7 +143,7 @@ void ChunkRenderPool::push(WorldView&& view, bool important, uint64_t stamp) {
 			return;
 		}
 
-		(important ? high_queue : low_queue).emplace(std::move(view), stamp);
+		(important ? high_queue : low_queue).emplace(std::move(view), stamp, important);
 		set.insert(chunk);
 	}
 
@@ -4,12 +4,14 @@
 #include "util/timer.hpp"
 #include "client/vertices.hpp"
 #include "world/view.hpp"
+#include "cache.hpp"
+#include "util/thread/pool.hpp"
 
 class World;
 class Chunk;
 class RenderSystem;
 class WorldRenderer;
-class ChunkFaceBuffer;
+class ChunkMaskBuffer;
 class MeshEmitterSet;
 
 class ChunkRenderPool {
@@ -23,15 +25,17 @@ class ChunkRenderPool {
 				WorldView view;
 				Timer timer;
 				uint64_t stamp;
+				bool important = false;
 
 			public:
 
 				UpdateRequest() = default;
-				UpdateRequest(WorldView&& view, uint64_t stamp);
+				UpdateRequest(WorldView&& view, uint64_t stamp, bool important);
 				glm::ivec3 origin() const;
 				WorldView&& unpack();
 
 				uint64_t getStamp() const;
+				bool isImportant() const;
 		};
 
 		bool stop = false;
@@ -40,8 +44,16 @@ class ChunkRenderPool {
 		std::queue<UpdateRequest> high_queue;
 		std::queue<UpdateRequest> low_queue;
 		std::condition_variable condition;
+
+		// the meshes of recently meshed chunks, so that edits only need to remesh the changed planes
+		ChunkMeshCache cache {32 * 1024 * 1024};
+
 		std::vector<std::thread> workers;
 
+		// used to mesh the planes of the important chunks in parallel, those are the player
+		// edits where the latency matters more, the normal updates are meshed by a single worker
+		TaskPool plane_pool {2};
+
 		WorldRenderer& renderer;
 		RenderSystem& system;
 		World& world;
@@ -53,7 +65,7 @@ class ChunkRenderPool {
 		bool empty();
 
 		/// emit the mesh of the given chunk into the given vector
-		void emitChunk(MeshEmitterSet& mesh, ChunkFaceBuffer& buffer, WorldView& view, uint64_t stamp);
+		void emitChunk(MeshEmitterSet& mesh, ChunkMaskBuffer& buffer, WorldView& view, uint64_t stamp, bool important);
 
 		/// the worker threads' main function
 		void run();
@@ -146,7 +146,13 @@ void WorldRenderer::prepare(CommandRecorder& recorder) {
 	}
 
 	// iterate all chunks that were updated this frame and need to be re-meshed
-	world.consumeUpdates([&] (WorldView&& view, bool important) {
+	world.consumeUpdates([&] (WorldView&& view, bool important, bool restored) {
+
+		// the chunk came back unchanged from the chunk cache, if we still have its mesh it's up to date
+		if (restored && buffers.contains(view.origin())) {
+			return;
+		}
+
 		mesher.push(std::move(view), important, unique_stamp ++);
 	});
 
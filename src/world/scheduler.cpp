@@ -0,0 +1,227 @@
+
+#include "scheduler.hpp"
+
+/*
+ * LoadScheduler
+ */
+
+int LoadScheduler::spanOf(glm::ivec2 offset, float radius, int vertical) {
+	float remaining = radius * radius - (offset.x * offset.x + offset.y * offset.y);
+
+	if (remaining <= 0) {
+		return -1;
+	}
+
+	// the largest integer whose square is strictly less than the remaining distance
+	return std::min(vertical - 1, (int) std::ceil(std::sqrt(remaining)) - 1);
+}
+
+bool LoadScheduler::inRange(glm::ivec3 pos) const {
+	return std::abs(pos.y - center.y) <= spanOf({pos.x - center.x, pos.z - center.z}, radius, vertical);
+}
+
+float LoadScheduler::priorityOf(glm::ivec3 pos) const {
+	glm::vec3 offset = pos - center;
+	float distance = glm::length(offset);
+
+	if (distance == 0) {
+		return 0;
+	}
+
+	// from 1x the distance for chunks straight ahead to 3x for those right behind
+	return distance * (2 - glm::dot(offset / distance, facing));
+}
+
+void LoadScheduler::enqueue(glm::ivec3 pos) {
+	if (queued.insert(pos).second) {
+		queue.push_back({priorityOf(pos), pos});
+		std::push_heap(queue.begin(), queue.end());
+	}
+}
+
+void LoadScheduler::expand(std::optional<glm::ivec3> previous) {
+	const int extent = (int) std::ceil(radius);
+
+	for (int dx = -extent; dx <= extent; dx ++) {
+		for (int dz = -extent; dz <= extent; dz ++) {
+			int span = spanOf({dx, dz}, radius, vertical);
+
+			if (span < 0) {
+				continue;
+			}
+
+			glm::ivec3 column {center.x + dx, 0, center.z + dz};
+
+			// the layers of this column that were already in range
+			int low = INT_MAX;
+			int high = INT_MIN;
+
+			if (previous) {
+				int old = spanOf({column.x - previous->x, column.z - previous->z}, radius, vertical);
+
+				if (old >= 0) {
+					low = previous->y - old;
+					high = previous->y + old;
+				}
+			}
+
+			for (int y = center.y - span; y <= center.y + span; y ++) {
+				if (y < low || y > high) {
+					enqueue({column.x, y, column.z});
+				}
+			}
+		}
+	}
+}
+
+void LoadScheduler::cancelOutside() {
+	std::lock_guard lock {mutex};
+
+	// the tasks that already started keep their entries until they finish, so that
+	// the chunk isn't scheduled again (and loaded twice) while it's still being loaded
+	std::erase_if(in_flight, [&] (glm::ivec3 pos) {
+		return !inRange(pos) && !running.contains(pos);
+	});
+}
+
+void LoadScheduler::rebuild() {
+	anchor = center;
+
+	std::erase_if(queue, [&] (const Request& request) {
+		if (inRange(request.pos)) {
+			return false;
+		}
+
+		queued.erase(request.pos);
+		return true;
+	});
+
+	for (Request& request : queue) {
+		request.priority = priorityOf(request.pos);
+	}
+
+	std::make_heap(queue.begin(), queue.end());
+}
+
+LoadScheduler::LoadScheduler(size_t threads, size_t limit)
+: limit(limit), pool(threads) {}
+
+void LoadScheduler::setLimit(size_t limit) {
+	this->limit = limit;
+}
+
+void LoadScheduler::update(glm::ivec3 center, glm::vec3 facing, float radius, int vertical, const Predicate& loaded, const Loader& load) {
+	const bool moved = center != this->center;
+	const bool turned = glm::dot(facing, this->facing) < 0.9f;
+	const bool resized = radius != this->radius || vertical != this->vertical;
+
+	if (!initialized || resized) {
+		this->center = center;
+		this->facing = facing;
+		this->radius = radius;
+		this->vertical = vertical;
+
+		queue.clear();
+		queued.clear();
+		cancelOutside();
+		rebuild();
+		expand(std::nullopt);
+		initialized = true;
+	} else if (moved || turned) {
+		glm::ivec3 previous = this->center;
+
+		this->center = center;
+		this->facing = facing;
+
+		if (moved) {
+			cancelOutside();
+			expand(previous);
+		}
+
+		// out of range entries are otherwise dropped lazily, when they reach the top of the queue
+		if (turned || glm::length2(glm::vec3(center - anchor)) > drift * drift) {
+			rebuild();
+		}
+	}
+
+	std::unique_lock lock {mutex};
+
+	while (in_flight.size() < limit && !queue.empty()) {
+		std::pop_heap(queue.begin(), queue.end());
+		glm::ivec3 pos = queue.back().pos;
+
+		queue.pop_back();
+		queued.erase(pos);
+
+		if (!inRange(pos) || in_flight.contains(pos) || loaded(pos)) {
+			continue;
+		}
+
+		in_flight.insert(pos);
+
+		pool.enqueue([this, pos, load] () {
+			{
+				std::lock_guard lock {mutex};
+
+				// the request was cancelled before we got to it
+				if (!in_flight.contains(pos)) {
+					return;
+				}
+
+				running.insert(pos);
+			}
+
+			const auto finish = [&] () {
+				{
+					std::lock_guard lock {mutex};
+					running.erase(pos);
+					in_flight.erase(pos);
+				}
+
+				idle.notify_all();
+			};
+
+			// the entries need to go even if the load fails, or the chunk could never be
+			// requested again and the scheduler would never look idle to the world
+			try {
+				load(pos);
+			} catch (...) {
+				finish();
+				throw;
+			}
+
+			finish();
+		});
+	}
+}
+
+void LoadScheduler::cancel() {
+	queue.clear();
+	queued.clear();
+	initialized = false;
+
+	std::lock_guard lock {mutex};
+	in_flight = running;
+}
+
+void LoadScheduler::wait() {
+	std::unique_lock lock {mutex};
+
+	idle.wait(lock, [this] () {
+		return running.empty();
+	});
+}
+
+size_t LoadScheduler::pending() const {
+	return queue.size();
+}
+
+size_t LoadScheduler::active() {
+	std::lock_guard lock {mutex};
+	return in_flight.size();
+}
+
+bool LoadScheduler::scheduled(glm::ivec3 pos) {
+	std::lock_guard lock {mutex};
+	return in_flight.contains(pos);
+}
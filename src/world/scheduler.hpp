@@ -0,0 +1,111 @@
+#pragma once
+
+#include "external.hpp"
+#include "util/thread/pool.hpp"
+
+/**
+ * Decides which chunks to load and in what order, keeps a priority queue (the frontier)
+ * of chunks that are in range but not yet loaded, ordered by distance and view direction. The frontier
+ * is only extended by the newly visible chunks when the camera enters a new chunk, and requests that
+ * fall out of range are dropped (or cancelled if they are already scheduled).
+ */
+class LoadScheduler {
+
+	public:
+
+		using Loader = std::function<void(glm::ivec3)>;
+		using Predicate = std::function<bool(glm::ivec3)>;
+
+	private:
+
+		struct Request {
+			float priority;
+			glm::ivec3 pos;
+
+			/// Reversed, so that the standard max-heap functions create a min-heap
+			bool operator < (const Request& other) const {
+				return priority > other.priority;
+			}
+		};
+
+		size_t limit;
+
+		// the frontier, only accessed by the thread calling update()
+		std::vector<Request> queue;
+		ankerl::unordered_dense::set<glm::ivec3> queued;
+
+		// re-prioritizing the whole frontier each time the camera moves would be wasteful,
+		// instead the priorities are only recomputed after moving this many chunks away from the anchor
+		static constexpr int drift = 4;
+
+		bool initialized = false;
+		glm::ivec3 anchor {0};
+		glm::ivec3 center {0};
+		glm::vec3 facing {0};
+		float radius = 0;
+		int vertical = 0;
+
+		// the scheduled and the already started (a subset of in_flight) requests
+		std::mutex mutex;
+		std::condition_variable idle;
+		ankerl::unordered_dense::set<glm::ivec3> in_flight;
+		ankerl::unordered_dense::set<glm::ivec3> running;
+
+		// needs to be declared last so that it's destroyed (and drained) first
+		TaskPool pool;
+
+		/// Returns the largest allowed distance from the center layer for the given column offset, or -1 if out of range
+		static int spanOf(glm::ivec2 offset, float radius, int vertical);
+
+		/// Checks if the given chunk is in range of the current center
+		bool inRange(glm::ivec3 pos) const;
+
+		/// Computes the priority (lower is sooner) of the given chunk, chunks in front of the camera come first
+		float priorityOf(glm::ivec3 pos) const;
+
+		/// Adds the given chunk to the frontier if it's not already there
+		void enqueue(glm::ivec3 pos);
+
+		/// Adds all chunks in range of the current center but not in range of the previous one to the frontier
+		void expand(std::optional<glm::ivec3> previous);
+
+		/// Cancels the scheduled requests that are no longer in range, the ones that already started are left to complete
+		void cancelOutside();
+
+		/// Drops out of range entries and recomputes priorities
+		void rebuild();
+
+	public:
+
+		LoadScheduler(size_t threads, size_t limit);
+
+		/// Sets the maximum number of chunks being loaded at the same time
+		void setLimit(size_t limit);
+
+		/**
+		 * Updates the frontier if the center, facing, or range changed and
+		 * starts new load tasks, skipping the chunks for which `loaded` returns true
+		 *
+		 * @param center   the chunk containing the camera
+		 * @param facing   the view direction of the camera
+		 * @param radius   the load radius, in chunks
+		 * @param vertical the number of layers loaded above and below the center
+		 */
+		void update(glm::ivec3 center, glm::vec3 facing, float radius, int vertical, const Predicate& loaded, const Loader& load);
+
+		/// Cancels all requests, tasks that already started will still complete
+		void cancel();
+
+		/// Waits for the tasks that already started to complete
+		void wait();
+
+		/// Returns the number of chunks waiting in the frontier
+		size_t pending() const;
+
+		/// Returns the number of chunks being loaded
+		size_t active();
+
+		/// Checks if the given chunk is scheduled or being loaded
+		bool scheduled(glm::ivec3 pos);
+
+};
@@ -0,0 +1,111 @@
+
+#include "cache.hpp"
+#include "codec.hpp"
+
+/*
+ * ChunkCache
+ */
+
+void ChunkCache::erase(decltype(entries)::iterator it) {
+	total -= it->second.bytes;
+	order.erase(it->second.order);
+	entries.erase(it);
+}
+
+void ChunkCache::trim() {
+	while (total > budget && !order.empty()) {
+		erase(entries.find(order.back()));
+	}
+}
+
+ChunkCache::ChunkCache(size_t budget)
+: budget(budget) {}
+
+void ChunkCache::put(std::shared_ptr<Chunk> chunk) {
+	const glm::ivec3 pos = chunk->pos;
+
+	{
+		std::lock_guard lock {mutex};
+		auto it = entries.find(pos);
+
+		if (it != entries.end()) {
+			erase(it);
+		}
+
+		const size_t bytes = sizeof(Chunk) + chunk->bytes();
+
+		order.push_front(pos);
+		entries.emplace(pos, Entry {order.begin(), chunk, {}, bytes});
+		total += bytes;
+		trim();
+	}
+
+	compressor.enqueue([this, chunk] () {
+		std::vector<uint8_t> data = ChunkCodec::encode(*chunk);
+
+		std::lock_guard lock {mutex};
+		auto it = entries.find(chunk->pos);
+
+		// the entry could have been taken, trimmed, or replaced in the meantime
+		if (it == entries.end() || it->second.chunk != chunk) {
+			return;
+		}
+
+		data.shrink_to_fit();
+		total = total - it->second.bytes + data.size();
+		it->second.bytes = data.size();
+		it->second.data = std::move(data);
+		it->second.chunk.reset();
+	});
+}
+
+Chunk* ChunkCache::take(glm::ivec3 pos) {
+	std::shared_ptr<Chunk> chunk;
+	std::vector<uint8_t> data;
+
+	{
+		std::lock_guard lock {mutex};
+		auto it = entries.find(pos);
+
+		if (it == entries.end()) {
+			miss_count ++;
+			return nullptr;
+		}
+
+		chunk = std::move(it->second.chunk);
+		data = std::move(it->second.data);
+		erase(it);
+	}
+
+	hit_count ++;
+
+	// not yet compressed, the world expects to take ownership so we still need to make a copy
+	if (chunk) {
+		data = ChunkCodec::encode(*chunk);
+	}
+
+	return ChunkCodec::decode(pos, data.data(), data.size());
+}
+
+bool ChunkCache::contains(glm::ivec3 pos) {
+	std::lock_guard lock {mutex};
+	return entries.contains(pos);
+}
+
+uint64_t ChunkCache::hits() const {
+	return hit_count;
+}
+
+uint64_t ChunkCache::misses() const {
+	return miss_count;
+}
+
+size_t ChunkCache::bytes() {
+	std::lock_guard lock {mutex};
+	return total;
+}
+
+size_t ChunkCache::size() {
+	std::lock_guard lock {mutex};
+	return entries.size();
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "external.hpp"
+#include "world/chunk.hpp"
+#include "util/thread/pool.hpp"
+
+/**
+ * Bounded LRU cache of recently unloaded chunks, the chunks are compressed using the
+ * ChunkCodec on a background thread, until that happens the entry simply keeps the chunk alive.
+ * Taking a chunk out of the cache removes the entry, so a cached copy is never older than the live chunk.
+ */
+class ChunkCache {
+
+	private:
+
+		struct Entry {
+			std::list<glm::ivec3>::iterator order;
+
+			// exactly one of those is set, the chunk is dropped once it's compressed
+			std::shared_ptr<Chunk> chunk;
+			std::vector<uint8_t> data;
+
+			size_t bytes;
+		};
+
+		std::mutex mutex;
+		size_t budget;
+		size_t total = 0;
+
+		std::list<glm::ivec3> order;
+		ankerl::unordered_dense::map<glm::ivec3, Entry> entries;
+
+		std::atomic<uint64_t> hit_count {0};
+		std::atomic<uint64_t> miss_count {0};
+
+		// needs to be declared last so that it's destroyed (and drained) first
+		TaskPool compressor {1};
+
+		/// Removes the entry and updates the byte count, requires the mutex to be held
+		void erase(decltype(entries)::iterator it);
+
+		/// Removes the least recently used entries until the budget is met, requires the mutex to be held
+		void trim();
+
+	public:
+
+		ChunkCache(size_t budget);
+
+		/// Adds an unloaded chunk to the cache, replacing any previous copy, the chunk must no longer be modified
+		void put(std::shared_ptr<Chunk> chunk);
+
+		/// Removes the given chunk from the cache and returns it, or returns nullptr if it's not cached
+		Chunk* take(glm::ivec3 pos);
+
+		/// Checks if the given chunk is cached
+		bool contains(glm::ivec3 pos);
+
+		/// Returns the number of take() calls that found the chunk
+		uint64_t hits() const;
+
+		/// Returns the number of take() calls that didn't find the chunk
+		uint64_t misses() const;
+
+		/// Returns the number of bytes used by the cached chunks
+		size_t bytes();
+
+		/// Returns the number of cached chunks
+		size_t size();
+
+};
@@ -0,0 +1,168 @@
+
+#include "codec.hpp"
+#include "util/exception.hpp"
+
+/*
+ * ChunkCodec
+ */
+
+void ChunkCodec::writeVarInt(std::vector<uint8_t>& output, uint32_t value) {
+	while (value >= 0x80) {
+		output.push_back((value & 0x7F) | 0x80);
+		value >>= 7;
+	}
+
+	output.push_back(value);
+}
+
+uint32_t ChunkCodec::readVarInt(const uint8_t*& input, const uint8_t* end) {
+	uint32_t value = 0;
+
+	for (int shift = 0; shift < 35; shift += 7) {
+		if (input >= end) {
+			break;
+		}
+
+		uint8_t byte = *(input ++);
+		value |= (uint32_t) (byte & 0x7F) << shift;
+
+		if ((byte & 0x80) == 0) {
+			return value;
+		}
+	}
+
+	throw Exception {"Malformed chunk data, invalid varint"};
+}
+
+std::vector<uint8_t> ChunkCodec::encode(Chunk& chunk) {
+	constexpr int volume = Chunk::size * Chunk::size * Chunk::size;
+
+	std::vector<uint8_t> output;
+	std::vector<Block> palette;
+	std::vector<std::pair<uint32_t, uint32_t>> runs;
+
+	// this is not the chunk's internal palette, it can contain stale entries
+	ankerl::unordered_dense::map<Block::packed_type, uint32_t> lookup;
+
+	// the snapshot makes it safe to encode a chunk that is still being edited
+	ChunkSnapshot snapshot = chunk.snapshot();
+	const ChunkData& data = *snapshot;
+
+	// uniform chunks are common, don't bother iterating them
+	if (data.uniform()) {
+		palette.push_back(data.getBlock(0, 0, 0));
+		runs.emplace_back(0, volume);
+	} else {
+		for (int z = 0; z < Chunk::size; z ++) {
+			for (int y = 0; y < Chunk::size; y ++) {
+				for (int x = 0; x < Chunk::size; x ++) {
+					Block block = data.getBlock(x, y, z);
+					auto [it, inserted] = lookup.try_emplace(block.packed(), palette.size());
+
+					if (inserted) {
+						palette.push_back(block);
+					}
+
+					if (!runs.empty() && runs.back().first == it->second) {
+						runs.back().second ++;
+					} else {
+						runs.emplace_back(it->second, 1);
+					}
+				}
+			}
+		}
+	}
+
+	output.reserve(16 + palette.size() * sizeof(Block) + runs.size() * 3);
+	output.push_back(version);
+	writeVarInt(output, palette.size());
+
+	for (Block block : palette) {
+		Block::packed_type packed = block.packed();
+		const uint8_t* bytes = (const uint8_t*) &packed;
+		output.insert(output.end(), bytes, bytes + sizeof(packed));
+	}
+
+	for (auto [index, length] : runs) {
+		writeVarInt(output, index);
+		writeVarInt(output, length - 1);
+	}
+
+	return output;
+}
+
+Chunk* ChunkCodec::decode(glm::ivec3 pos, const uint8_t* data, size_t size) {
+	constexpr int volume = Chunk::size * Chunk::size * Chunk::size;
+
+	const uint8_t* end = data + size;
+
+	if (size < 1 || *(data ++) != version) {
+		throw Exception {"Malformed chunk data, unknown version"};
+	}
+
+	uint32_t count = readVarInt(data, end);
+
+	if (count == 0 || (size_t) (end - data) < count * sizeof(Block)) {
+		throw Exception {"Malformed chunk data, invalid palette"};
+	}
+
+	std::vector<Block> palette;
+	std::vector<int> usage(count, 0);
+	palette.reserve(count);
+
+	for (uint32_t i = 0; i < count; i ++) {
+		Block::packed_type packed;
+		std::memcpy(&packed, data, sizeof(packed));
+		palette.emplace_back(packed);
+		data += sizeof(packed);
+	}
+
+	std::vector<std::pair<uint32_t, uint32_t>> runs;
+	int total = 0;
+
+	while (total < volume) {
+		uint32_t index = readVarInt(data, end);
+		uint32_t length = readVarInt(data, end) + 1;
+
+		if (index >= count || length > (uint32_t) (volume - total)) {
+			throw Exception {"Malformed chunk data, invalid run"};
+		}
+
+		runs.emplace_back(index, length);
+		usage[index] += length;
+		total += length;
+	}
+
+	Chunk* chunk = new Chunk {pos};
+
+	// start with the most common block, and only write the remaining ones, for most
+	// terrain that is either air or stone, which skips the majority of the writes
+	uint32_t common = std::max_element(usage.begin(), usage.end()) - usage.begin();
+	chunk->fill(palette[common]);
+
+	int index = 0;
+
+	for (auto [entry, length] : runs) {
+		if (entry == common) {
+			index += length;
+			continue;
+		}
+
+		// a run can span many rows, each part of it within one row is written at once
+		while (length > 0) {
+			const int x = index & Chunk::mask;
+			const int y = (index >> Chunk::bits) & Chunk::mask;
+			const int z = index >> (2 * Chunk::bits);
+			const int count = std::min<int>(length, Chunk::size - x);
+
+			chunk->fill({x, y, z}, {x + count - 1, y, z}, palette[entry]);
+			index += count;
+			length -= count;
+		}
+	}
+
+	chunk->compact();
+	chunk->setModified(false);
+
+	return chunk;
+}
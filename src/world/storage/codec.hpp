@@ -0,0 +1,31 @@
+#pragma once
+
+#include "external.hpp"
+#include "world/chunk.hpp"
+
+/**
+ * Compact serialized form of a single chunk, used both for the on-disk region files
+ * and for in-memory copies of unloaded chunks. The payload is a list of the distinct blocks
+ * followed by run-length encoded palette indices in the usual x, y, z order, all integers are varints.
+ *
+ * @verbatim
+ * u8 version | palette size | palette size * 8 byte block | (index, run length - 1)...
+ */
+class ChunkCodec {
+
+	private:
+
+		static constexpr uint8_t version = 1;
+
+		static void writeVarInt(std::vector<uint8_t>& output, uint32_t value);
+		static uint32_t readVarInt(const uint8_t*& input, const uint8_t* end);
+
+	public:
+
+		/// Serializes the content of the given chunk, the position is not included, safe to call from any thread
+		static std::vector<uint8_t> encode(Chunk& chunk);
+
+		/// Creates a new chunk at the given position from the serialized data, throws Exception on malformed input
+		static Chunk* decode(glm::ivec3 pos, const uint8_t* data, size_t size);
+
+};
@@ -0,0 +1,210 @@
+
+#include "region.hpp"
+#include "codec.hpp"
+#include "util/logger.hpp"
+
+/*
+ * RegionFile
+ */
+
+int RegionFile::indexOf(glm::ivec3 chunk) {
+	return (chunk.x & mask) + (chunk.y & mask) * size + (chunk.z & mask) * size * size;
+}
+
+uint32_t RegionFile::sectorsOf(uint32_t length) {
+	return (length + sector - 1) / sector;
+}
+
+uint32_t RegionFile::allocate(uint32_t sectors) {
+	uint32_t start = header;
+	uint32_t found = 0;
+
+	for (uint32_t i = header; i < used.size() && found < sectors; i ++) {
+		if (used[i]) {
+			start = i + 1;
+			found = 0;
+		} else {
+			found ++;
+		}
+	}
+
+	// not enough free space between payloads, grow the file
+	if (found < sectors) {
+		used.resize(start + sectors, false);
+	}
+
+	std::fill_n(used.begin() + start, sectors, true);
+	return start;
+}
+
+RegionFile::RegionFile(const std::filesystem::path& path) {
+	table.fill({0, 0});
+	used.resize(header, true);
+
+	if (!std::filesystem::exists(path)) {
+		std::ofstream output {path, std::ios::binary};
+		output.write((const char*) table.data(), sizeof(table));
+	}
+
+	file.open(path, std::ios::in | std::ios::out | std::ios::binary);
+
+	if (!file.read((char*) table.data(), sizeof(table))) {
+		throw Exception {"Failed to read region file header of '" + path.string() + "'"};
+	}
+
+	for (Entry& entry : table) {
+		if (entry.sector != 0) {
+			uint32_t end = entry.sector + sectorsOf(entry.length);
+
+			if (end > used.size()) {
+				used.resize(end, false);
+			}
+
+			std::fill(used.begin() + entry.sector, used.begin() + end, true);
+		}
+	}
+}
+
+bool RegionFile::read(glm::ivec3 chunk, std::vector<uint8_t>& data) {
+	std::lock_guard lock {mutex};
+	Entry entry = table[indexOf(chunk)];
+
+	if (entry.sector == 0) {
+		return false;
+	}
+
+	data.resize(entry.length);
+	file.seekg((std::streamoff) entry.sector * sector);
+
+	if (!file.read((char*) data.data(), entry.length)) {
+		file.clear();
+		throw Exception {"Failed to read chunk payload from region file"};
+	}
+
+	return true;
+}
+
+void RegionFile::write(glm::ivec3 chunk, const std::vector<uint8_t>& data) {
+	std::lock_guard lock {mutex};
+	const int index = indexOf(chunk);
+
+	Entry previous = table[index];
+	Entry entry {allocate(sectorsOf(data.size())), (uint32_t) data.size()};
+
+	// pad the payload to whole sectors so that the file never ends mid-sector
+	std::vector<char> padding(sectorsOf(entry.length) * sector - entry.length, 0);
+
+	file.seekp((std::streamoff) entry.sector * sector);
+	file.write((const char*) data.data(), data.size());
+	file.write(padding.data(), padding.size());
+	file.flush();
+
+	table[index] = entry;
+	file.seekp(index * sizeof(Entry));
+	file.write((const char*) &entry, sizeof(Entry));
+	file.flush();
+
+	if (!file) {
+		file.clear();
+		throw Exception {"Failed to write chunk payload to region file"};
+	}
+
+	if (previous.sector != 0) {
+		std::fill_n(used.begin() + previous.sector, sectorsOf(previous.length), false);
+	}
+}
+
+/*
+ * RegionStore
+ */
+
+RegionFile& RegionStore::regionOf(glm::ivec3 chunk) {
+	glm::ivec3 key {chunk.x >> RegionFile::bits, chunk.y >> RegionFile::bits, chunk.z >> RegionFile::bits};
+	std::lock_guard lock {regions_mutex};
+
+	auto it = regions.find(key);
+
+	if (it == regions.end()) {
+		std::string name = std::to_string(key.x) + "." + std::to_string(key.y) + "." + std::to_string(key.z) + ".region";
+		it = regions.emplace(key, std::make_unique<RegionFile>(directory / name)).first;
+	}
+
+	return *it->second;
+}
+
+RegionStore::RegionStore(const std::filesystem::path& directory)
+: directory(directory) {
+	std::filesystem::create_directories(directory);
+}
+
+Chunk* RegionStore::load(glm::ivec3 pos) {
+	std::shared_ptr<Chunk> waiting;
+
+	{
+		std::lock_guard lock {pending_mutex};
+		auto it = pending.find(pos);
+
+		if (it != pending.end()) {
+			waiting = it->second;
+		}
+	}
+
+	// the chunk was unloaded but not yet written, so what's on the disk is stale
+	if (waiting) {
+		std::vector<uint8_t> data = ChunkCodec::encode(*waiting);
+		Chunk* chunk = ChunkCodec::decode(pos, data.data(), data.size());
+
+		// it's still not on the disk
+		chunk->setModified(true);
+		return chunk;
+	}
+
+	try {
+		std::vector<uint8_t> data;
+
+		if (regionOf(pos).read(pos, data)) {
+			return ChunkCodec::decode(pos, data.data(), data.size());
+		}
+	} catch (Exception& exception) {
+		logger::error("Failed to load chunk ", pos.x, " ", pos.y, " ", pos.z, ", ", exception.getMessage());
+	}
+
+	return nullptr;
+}
+
+void RegionStore::save(std::shared_ptr<Chunk> chunk) {
+	{
+		std::lock_guard lock {pending_mutex};
+		pending[chunk->pos] = chunk;
+	}
+
+	writer.enqueue([this, chunk] () {
+		{
+			std::lock_guard lock {pending_mutex};
+			auto it = pending.find(chunk->pos);
+
+			// a newer version of this chunk is already waiting to be written
+			if (it == pending.end() || it->second != chunk) {
+				return;
+			}
+		}
+
+		try {
+			regionOf(chunk->pos).write(chunk->pos, ChunkCodec::encode(*chunk));
+			chunk->setModified(false);
+		} catch (Exception& exception) {
+			logger::error("Failed to save chunk ", chunk->pos.x, " ", chunk->pos.y, " ", chunk->pos.z, ", ", exception.getMessage());
+		}
+
+		std::lock_guard lock {pending_mutex};
+		auto it = pending.find(chunk->pos);
+
+		if (it != pending.end() && it->second == chunk) {
+			pending.erase(it);
+		}
+	});
+}
+
+void RegionStore::flush() {
+	writer.defer([] () { return true; }).get();
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "external.hpp"
+#include "world/chunk.hpp"
+#include "util/thread/pool.hpp"
+
+/**
+ * A single region file, holds a fixed 8x8x8 grid of chunks. The file starts with a one page
+ * offset table (one entry per chunk) followed by the compressed chunk payloads, each payload starts at
+ * a sector boundary so the whole file can be memory mapped and a chunk read without parsing anything but the table.
+ *
+ * @verbatim
+ * [offset table, 8 sectors] [payload] [payload] ...
+ * table entry: u32 first sector (0 if not stored) | u32 payload length in bytes
+ */
+class RegionFile {
+
+	public:
+
+		static constexpr int size = 8;
+		static constexpr int mask = size - 1;
+		static constexpr int bits = std::popcount((size_t) mask);
+		static constexpr int sector = 512;
+
+		static_assert(std::popcount((size_t) size) == 1, "RegionFile::size needs to be a power of 2");
+
+	private:
+
+		struct Entry {
+			uint32_t sector;
+			uint32_t length;
+		};
+
+		static constexpr int entries = size * size * size;
+		static constexpr int header = entries * sizeof(Entry) / sector;
+
+		static_assert(entries * sizeof(Entry) % sector == 0, "RegionFile offset table needs to take whole sectors");
+
+		std::mutex mutex;
+		std::fstream file;
+		std::array<Entry, entries> table;
+
+		// one element per sector, true if it's taken by the header or a payload
+		std::vector<bool> used;
+
+		static int indexOf(glm::ivec3 chunk);
+		static uint32_t sectorsOf(uint32_t length);
+
+		/// Finds (or appends) a run of free sectors of the given length
+		uint32_t allocate(uint32_t sectors);
+
+	public:
+
+		RegionFile(const std::filesystem::path& path);
+
+		/// Reads the payload of the given chunk (given in any coordinates, only the local part is used), returns false if not stored
+		bool read(glm::ivec3 chunk, std::vector<uint8_t>& data);
+
+		/// Writes the payload of the given chunk, the old payload is only released once the table points to the new one
+		void write(glm::ivec3 chunk, const std::vector<uint8_t>& data);
+
+};
+
+/**
+ * Loads and stores chunks in a directory of region files, writes are performed
+ * asynchronously on a single background thread (which keeps them ordered), chunks waiting
+ * to be written can still be loaded. Region files are opened on first use and stay open.
+ */
+class RegionStore {
+
+	private:
+
+		std::filesystem::path directory;
+
+		std::mutex regions_mutex;
+		ankerl::unordered_dense::map<glm::ivec3, std::unique_ptr<RegionFile>> regions;
+
+		std::mutex pending_mutex;
+		ankerl::unordered_dense::map<glm::ivec3, std::shared_ptr<Chunk>> pending;
+
+		// needs to be declared last so that it's destroyed (and drained) first
+		TaskPool writer {1};
+
+		/// Returns the region file containing the given chunk, creates it if needed
+		RegionFile& regionOf(glm::ivec3 chunk);
+
+	public:
+
+		RegionStore(const std::filesystem::path& directory);
+
+		/// Loads the given chunk, returns nullptr if it was never stored
+		Chunk* load(glm::ivec3 pos);
+
+		/// Schedules the given chunk to be written, it should not be modified until the write completes
+		void save(std::shared_ptr<Chunk> chunk);
+
+		/// Blocks until all scheduled writes are complete
+		void flush();
+
+};
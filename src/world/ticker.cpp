@@ -0,0 +1,270 @@
+
+#include "ticker.hpp"
+#include "world.hpp"
+#include "util/thread/pool.hpp"
+
+static constexpr int volume = Chunk::size * Chunk::size * Chunk::size;
+
+static glm::ivec3 chunkOf(glm::ivec3 pos) {
+	return {pos.x >> Chunk::bits, pos.y >> Chunk::bits, pos.z >> Chunk::bits};
+}
+
+/*
+ * TickContext
+ */
+
+TickContext::TickContext(World& world, size_t seed)
+: accessor(world), random(seed) {}
+
+Block TickContext::getBlock(glm::ivec3 pos) {
+	return accessor.getBlock(pos.x, pos.y, pos.z);
+}
+
+void TickContext::setBlock(glm::ivec3 pos, Block block) {
+
+	// check it now, so that the edits can't fail once they are applied
+	if (!accessor.getChunk(pos.x >> Chunk::bits, pos.y >> Chunk::bits, pos.z >> Chunk::bits)) {
+		throw AccessError {pos.x, pos.y, pos.z};
+	}
+
+	edits.push_back({pos, block});
+}
+
+void TickContext::schedule(glm::ivec3 pos, int delay) {
+	scheduled.emplace_back(pos, delay);
+}
+
+Random& TickContext::getRandom() {
+	return random;
+}
+
+/*
+ * BlockTicker
+ */
+
+void BlockTicker::enqueue(glm::ivec3 pos, uint64_t due) {
+	std::vector<ScheduledTick>& queue = scheduled[chunkOf(pos)];
+	const uint16_t index = (pos.x & Chunk::mask) | ((pos.y & Chunk::mask) << Chunk::bits) | ((pos.z & Chunk::mask) << (2 * Chunk::bits));
+
+	queue.push_back({due, index});
+	std::push_heap(queue.begin(), queue.end());
+}
+
+const BlockTicker::Behaviour* BlockTicker::getBehaviour(uint16_t type) const {
+	if (type < behaviours.size() && behaviours[type].handler) {
+		return &behaviours[type];
+	}
+
+	return nullptr;
+}
+
+bool BlockTicker::hasRandomHandler(const std::vector<Block>& blocks) const {
+	for (Block block : blocks) {
+		const Behaviour* behaviour = getBehaviour(block.block_type);
+
+		if (behaviour && behaviour->random) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void BlockTicker::setHandler(uint16_t type, const Handler& handler, bool random) {
+	if (type >= behaviours.size()) {
+		behaviours.resize(type + 1);
+	}
+
+	behaviours[type] = {handler, random};
+}
+
+void BlockTicker::schedule(glm::ivec3 pos, int delay) {
+	std::lock_guard lock {mutex};
+	enqueue(pos, time + std::max(delay, 1));
+}
+
+void BlockTicker::track(Chunk& chunk) {
+	ChunkSnapshot snapshot = chunk.snapshot();
+
+	if (hasRandomHandler(snapshot->getPalette())) {
+		std::lock_guard lock {mutex};
+		candidates[chunk.pos] = snapshot.version;
+	}
+}
+
+void BlockTicker::notify(glm::ivec3 pos, Block block) {
+	const Behaviour* behaviour = getBehaviour(block.block_type);
+
+	if (behaviour && behaviour->random) {
+		std::lock_guard lock {mutex};
+
+		// the version is not known here, it will be checked again on the next tick
+		candidates.try_emplace(chunkOf(pos), 0);
+	}
+}
+
+void BlockTicker::tick(World& world, TaskPool& pool, std::vector<BlockEdit>& edits) {
+
+	struct ChunkWork {
+		std::shared_ptr<Chunk> chunk;
+		std::vector<uint16_t> due;
+		bool random = false;
+	};
+
+	struct Region {
+		std::vector<ChunkWork*> chunks;
+		std::unique_ptr<TickContext> context;
+	};
+
+	// only held while collecting the work and merging the results, so the handlers
+	// don't block the loading threads that track new chunks and notify block changes
+	std::unique_lock lock {mutex};
+	time ++;
+
+	ankerl::unordered_dense::map<glm::ivec3, ChunkWork> work;
+	std::vector<glm::ivec3> removed;
+
+	for (auto& [key, queue] : scheduled) {
+		if (queue.front().due > time) {
+			continue;
+		}
+
+		// ticks that are due in unloaded chunks are dropped
+		std::shared_ptr<Chunk> chunk = world.getChunk(key.x, key.y, key.z).lock();
+		ChunkWork* entry = chunk ? &work[key] : nullptr;
+
+		while (!queue.empty() && queue.front().due <= time) {
+			if (entry) {
+				entry->due.push_back(queue.front().index);
+			}
+
+			std::pop_heap(queue.begin(), queue.end());
+			queue.pop_back();
+		}
+
+		if (entry) {
+			entry->chunk = std::move(chunk);
+		}
+
+		if (queue.empty()) {
+			removed.push_back(key);
+		}
+	}
+
+	for (glm::ivec3 key : removed) {
+		scheduled.erase(key);
+	}
+
+	removed.clear();
+
+	for (auto& [key, version] : candidates) {
+		std::shared_ptr<Chunk> chunk = world.getChunk(key.x, key.y, key.z).lock();
+
+		// the palette can only gain new blocks with a write, so it's enough to check it after each one
+		if (chunk && chunk->getVersion() != version) {
+			ChunkSnapshot snapshot = chunk->snapshot();
+			version = snapshot.version;
+
+			if (!hasRandomHandler(snapshot->getPalette())) {
+				chunk.reset();
+			}
+		}
+
+		if (!chunk) {
+			removed.push_back(key);
+			continue;
+		}
+
+		ChunkWork& entry = work[key];
+		entry.chunk = std::move(chunk);
+		entry.random = true;
+	}
+
+	for (glm::ivec3 key : removed) {
+		candidates.erase(key);
+	}
+
+	ankerl::unordered_dense::map<glm::ivec3, Region> regions;
+
+	for (auto& [key, entry] : work) {
+		glm::ivec3 region {key.x >> region_bits, key.y >> region_bits, key.z >> region_bits};
+		regions[region].chunks.push_back(&entry);
+	}
+
+	lock.unlock();
+
+	std::vector<std::future<bool>> futures;
+	futures.reserve(regions.size());
+
+	for (auto& [key, region] : regions) {
+		size_t seed = time * 73856093 ^ key.x * 19349663 ^ key.y * 83492791 ^ key.z * 2654435761;
+
+		futures.push_back(pool.defer([this, &world, &region, seed] () {
+			region.context = std::make_unique<TickContext>(world, seed);
+			TickContext& context = *region.context;
+
+			const auto run = [&] (Chunk& chunk, int index, bool random) {
+				glm::ivec3 local {index & Chunk::mask, (index >> Chunk::bits) & Chunk::mask, index >> (2 * Chunk::bits)};
+				Block block = chunk.getBlock(local.x, local.y, local.z);
+				const Behaviour* behaviour = getBehaviour(block.block_type);
+
+				if (!behaviour || (random && !behaviour->random)) {
+					return;
+				}
+
+				// a handler that reaches into an unloaded chunk is stopped there,
+				// the edits it made before that are still applied
+				try {
+					behaviour->handler(context, chunk.pos * Chunk::size + local, block);
+				} catch (AccessError&) {
+					return;
+				}
+			};
+
+			for (ChunkWork* entry : region.chunks) {
+				for (uint16_t index : entry->due) {
+					run(*entry->chunk, index, false);
+				}
+
+				if (entry->random) {
+					for (int i = 0; i < random_samples; i ++) {
+						run(*entry->chunk, context.getRandom().uniformInt(volume - 1), true);
+					}
+				}
+			}
+
+			return true;
+		}));
+	}
+
+	for (auto& future : futures) {
+		future.get();
+	}
+
+	lock.lock();
+
+	for (auto& [key, region] : regions) {
+		TickContext& context = *region.context;
+		edits.insert(edits.end(), context.edits.begin(), context.edits.end());
+
+		for (auto [pos, delay] : context.scheduled) {
+			enqueue(pos, time + std::max(delay, 1));
+		}
+	}
+
+}
+
+uint64_t BlockTicker::getTime() const {
+	return time;
+}
+
+size_t BlockTicker::pending() {
+	std::lock_guard lock {mutex};
+	size_t count = 0;
+
+	for (auto& [key, queue] : scheduled) {
+		count += queue.size();
+	}
+
+	return count;
+}
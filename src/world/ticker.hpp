@@ -0,0 +1,133 @@
+#pragma once
+
+#include "external.hpp"
+#include "block.hpp"
+#include "chunk.hpp"
+#include "accessor.hpp"
+#include "util/math/random.hpp"
+
+class World;
+class TaskPool;
+
+/**
+ * Passed to the block tick handlers, the reads see the world as it was before the current tick,
+ * the writes and scheduled ticks are collected and only applied once all the handlers completed,
+ * so handlers in different regions can run at the same time
+ */
+class TickContext {
+
+	private:
+
+		friend class BlockTicker;
+
+		BlockAccessor accessor;
+		Random random;
+
+		std::vector<BlockEdit> edits;
+		std::vector<std::pair<glm::ivec3, int>> scheduled;
+
+	public:
+
+		TickContext(World& world, size_t seed);
+
+		/// Returns the block at the given world position, if the
+		/// containing chunk is not loaded throws AccessError
+		Block getBlock(glm::ivec3 pos);
+
+		/// Sets the block at the given world position at the end of the tick,
+		/// if the containing chunk is not loaded throws AccessError
+		void setBlock(glm::ivec3 pos, Block block);
+
+		/// Schedules a tick of the block at the given world position after the given number of ticks
+		void schedule(glm::ivec3 pos, int delay);
+
+		/// Returns the random number generator of this context
+		Random& getRandom();
+
+};
+
+/**
+ * Runs the per-block updates, handlers are registered for block types and called either when a tick
+ * scheduled for a position becomes due, or when a randomly sampled block in a loaded chunk has a random handler.
+ * The scheduled ticks are kept in a priority queue per chunk, and random ticks are only sampled in chunks
+ * that can contain a block with a random handler, so chunks with no pending work are never visited.
+ * The chunks are grouped into regions of 4x4x4 chunks and each region with work runs as a separate task.
+ */
+class BlockTicker {
+
+	public:
+
+		using Handler = std::function<void(TickContext&, glm::ivec3, Block)>;
+
+		/// number of blocks sampled per chunk in each tick, the same density as three per 16x16x16 blocks
+		static constexpr int random_samples = 24;
+
+		/// the size of the regions (in chunks) that are processed as one task, as a power of two
+		static constexpr int region_bits = 2;
+
+	private:
+
+		struct ScheduledTick {
+			uint64_t due;
+			uint16_t index;
+
+			/// Reversed, so that the standard max-heap functions create a min-heap
+			bool operator < (const ScheduledTick& other) const {
+				return due > other.due;
+			}
+		};
+
+		struct Behaviour {
+			Handler handler;
+			bool random = false;
+		};
+
+		uint64_t time = 0;
+
+		// indexed by block type, empty for types with no handler
+		std::vector<Behaviour> behaviours;
+
+		std::mutex mutex;
+
+		// the pending scheduled ticks of each chunk, chunks with no pending ticks are removed
+		ankerl::unordered_dense::map<glm::ivec3, std::vector<ScheduledTick>> scheduled;
+
+		// chunks that can contain a block with a random handler, with the version at which that was last checked
+		ankerl::unordered_dense::map<glm::ivec3, uint64_t> candidates;
+
+		/// Adds a tick due at the given time to the queue of the containing chunk, requires the mutex to be held
+		void enqueue(glm::ivec3 pos, uint64_t due);
+
+		/// Returns the behaviour of the given block type, or null if there is none
+		const Behaviour* getBehaviour(uint16_t type) const;
+
+		/// Checks if any of the given blocks has a random handler
+		bool hasRandomHandler(const std::vector<Block>& blocks) const;
+
+	public:
+
+		/// Registers the handler of the given block type, if `random` is set
+		/// the handler is also called for the random ticks, not just the scheduled ones
+		void setHandler(uint16_t type, const Handler& handler, bool random);
+
+		/// Schedules a tick of the block at the given world position after the given number of ticks,
+		/// the tick is dropped if the chunk is not loaded when it's due
+		void schedule(glm::ivec3 pos, int delay);
+
+		/// Checks the newly loaded chunk for blocks with a random handler
+		void track(Chunk& chunk);
+
+		/// Notifies the ticker that the given block was placed at the given world position
+		void notify(glm::ivec3 pos, Block block);
+
+		/// Runs one tick, each region with work runs as a separate task on the given pool,
+		/// the edits made by the handlers are not applied, but appended to `edits` instead
+		void tick(World& world, TaskPool& pool, std::vector<BlockEdit>& edits);
+
+		/// Returns the number of ticks run so far
+		uint64_t getTime() const;
+
+		/// Returns the number of pending scheduled ticks
+		size_t pending();
+
+};
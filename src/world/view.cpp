@@ -27,7 +27,7 @@ WorldView::WorldView(World& world, const std::shared_ptr<Chunk>& center, Directi
 
 	for (Direction direction : Direction::decompose(directions)) {
 		glm::ivec3 key = center_chunk + Direction::offset(direction);
-		std::shared_ptr<Chunk> lock = world.getUnsafeChunk(key.x, key.y, key.z).lock();
+		std::shared_ptr<Chunk> lock = world.getChunk(key.x, key.y, key.z).lock();
 
 		// terrain got unloaded, we are no longer in the view distance
 		if (!lock) {
@@ -44,6 +44,19 @@ bool WorldView::failed() const {
 	return failed_to_lock;
 }
 
+void WorldView::capture() {
+	for (int i = 0; i < 3*3*3; i ++) {
+		if (chunks[i]) {
+			snapshots[i] = chunks[i]->snapshot();
+		}
+	}
+}
+
+bool WorldView::stale() const {
+	const int index = indexOf(center_chunk.x, center_chunk.y, center_chunk.z);
+	return chunks[index]->getVersion() != snapshots[index].version;
+}
+
 glm::ivec3 WorldView::origin() const {
 	return center_chunk;
 }
@@ -58,10 +71,44 @@ Block WorldView::getBlock(int x, int y, int z) {
 	return getChunk(cx, cy, cz)->getBlock(x & mask, y & mask, z & mask);
 }
 
-Chunk* WorldView::getChunk(int cx, int cy, int cz) {
-	return chunks[indexOf(cx, cy, cz)].get();
+bool WorldView::isAir(int x, int y, int z) {
+	int cx = x >> Chunk::bits;
+	int cy = y >> Chunk::bits;
+	int cz = z >> Chunk::bits;
+
+	return !getChunk(cx, cy, cz)->occupied(x & Chunk::mask, y & Chunk::mask, z & Chunk::mask);
 }
 
-Chunk* WorldView::getOriginChunk() {
+const ChunkData* WorldView::getChunk(int cx, int cy, int cz) {
+	const ChunkSnapshot& snapshot = snapshots[indexOf(cx, cy, cz)];
+	return snapshot ? &*snapshot : nullptr;
+}
+
+const ChunkData* WorldView::getOriginChunk() {
 	return getChunk(origin().x, origin().y, origin().z);
+}
+
+const std::shared_ptr<Chunk>& WorldView::getSource(int cx, int cy, int cz) const {
+	return chunks[indexOf(cx, cy, cz)];
+}
+
+uint64_t WorldView::getVersion(int cx, int cy, int cz) const {
+	return snapshots[indexOf(cx, cy, cz)].version;
+}
+
+bool WorldView::enclosed() {
+	if (!getOriginChunk()->solid()) {
+		return false;
+	}
+
+	for (Direction direction : Direction::decompose(Direction::ALL)) {
+		glm::ivec3 key = center_chunk + Direction::offset(direction);
+		const ChunkData* chunk = getChunk(key.x, key.y, key.z);
+
+		if (!chunk || !chunk->solid()) {
+			return false;
+		}
+	}
+
+	return true;
 }
\ No newline at end of file
@@ -3,9 +3,9 @@
 #include "external.hpp"
 #include "util/type/direction.hpp"
 
+#include "chunk.hpp"
+
 class World;
-class Chunk;
-class Block;
 
 class WorldView {
 
@@ -16,6 +16,7 @@ class WorldView {
 		glm::ivec3 center_chunk;
 		bool failed_to_lock = false;
 		std::shared_ptr<Chunk> chunks[3*3*3];
+		ChunkSnapshot snapshots[3*3*3];
 
 	public:
 
@@ -25,16 +26,36 @@ class WorldView {
 		/// Check if the view was successfully acquired, if not the view should be discarded
 		bool failed() const;
 
+		/// Takes snapshots of all the chunks in the view, this needs to be called before any blocks are read,
+		/// after that the view is immutable and can be used without any locking
+		void capture();
+
+		/// Checks if the center chunk was modified after the view was captured
+		bool stale() const;
+
 		/// Get the chunk coordinates of the center chunk
 		glm::ivec3 origin() const;
 
 		/// Get a block at a particular world-pos from the view
 		Block getBlock(int x, int y, int z);
 
-		/// Return an pointer ot the chunk, the lifetime is equal to that of the view
-		Chunk* getChunk(int cx, int cy, int cz);
+		/// Check if the block at a particular world-pos is air, uses the chunk occupancy mask
+		bool isAir(int x, int y, int z);
+
+		/// Return a pointer to the captured chunk data, the lifetime is equal to that of the view
+		const ChunkData* getChunk(int cx, int cy, int cz);
 
 		/// Similar to getChunk but returns the chunk pointer to by origin()
-		Chunk* getOriginChunk();
+		const ChunkData* getOriginChunk();
+
+		/// Returns the live chunk the captured data was taken from, or null if it's not part of the view
+		const std::shared_ptr<Chunk>& getSource(int cx, int cy, int cz) const;
+
+		/// Returns the version of the captured data of the given chunk
+		uint64_t getVersion(int cx, int cy, int cz) const;
+
+		/// Checks if the origin chunk and all its face neighbours are uniformly
+		/// solid, such a chunk has no visible faces and doesn't need to be meshed
+		bool enclosed();
 
 };
\ No newline at end of file
@@ -16,93 +16,236 @@ const char* AccessError::what() const noexcept {
  * World
  */
 
-WorldView World::getUnsafeView(glm::ivec3 chunk, Direction directions) {
-	std::shared_ptr<Chunk> center = getUnsafeChunk(chunk.x, chunk.y, chunk.z).lock();
+World::World(const std::filesystem::path& directory)
+: store(std::make_unique<RegionStore>(directory)) {}
+
+World::~World() {
+	scheduler.cancel();
+	scheduler.wait();
+}
+
+WorldView World::getView(glm::ivec3 chunk, Direction directions) {
+	std::shared_ptr<Chunk> center = getChunk(chunk.x, chunk.y, chunk.z).lock();
 	return WorldView {*this, center, directions};
 }
 
 void World::pushChunkUpdate(glm::ivec3 chunk, uint8_t flags) {
 	std::lock_guard lock {updates_mutex};
-	updates[chunk] |= flags;
+	auto [it, inserted] = updates.try_emplace(chunk, flags);
+
+	if (!inserted) {
+		it->second = ChunkUpdate::merge(it->second, flags);
+	}
+}
+
+void World::pushChunkUpdates(const std::vector<std::pair<glm::ivec3, uint8_t>>& flags) {
+	std::lock_guard lock {updates_mutex};
+
+	for (auto [chunk, flag] : flags) {
+		auto [it, inserted] = updates.try_emplace(chunk, flag);
+
+		if (!inserted) {
+			it->second = ChunkUpdate::merge(it->second, flag);
+		}
+	}
+}
+
+void World::pushBlockUpdate(glm::ivec3 chunk, int x, int y, int z, Block block) {
+	glm::ivec3 pos = chunk * Chunk::size + glm::ivec3 {x, y, z};
+	columns.updateHeight(pos.x, pos.z, pos.y, pos.y, block.isAir());
+	fluids.activate(pos);
+	ticker.notify(pos, block);
+
+	// setting non-air blocks doesn't require updating neighbours (for now)
+	pushChunkUpdate(chunk, ChunkUpdate::IMPORTANT | (block.isAir() ? Chunk::getNeighboursMask(x, y, z).mask : Direction::NONE));
+}
+
+void World::emplace(Chunk* chunk, uint8_t flags) {
+	glm::ivec3 pos = chunk->pos;
+
+	ticker.track(*chunk);
+	columns.emplace(chunk);
+	pushChunkUpdate(pos, flags);
+}
+
+void World::emplace(Chunk* chunk) {
+	emplace(chunk, ChunkUpdate::INITIAL_LOAD);
+}
+
+ChunkCache& World::getCache() {
+	return cache;
 }
 
-void World::update(WorldGenerator& generator, glm::ivec3 origin, float radius, float vertical) {
+LoadScheduler& World::getScheduler() {
+	return scheduler;
+}
+
+FluidSimulator& World::getFluids() {
+	return fluids;
+}
+
+BlockTicker& World::getTicker() {
+	return ticker;
+}
+
+void World::setMemoryBudget(size_t bytes) {
+	budget = bytes;
+}
+
+size_t World::getMemoryBudget() const {
+	return budget;
+}
+
+size_t World::getMemoryUsage() const {
+	return memory_usage;
+}
 
-	int py = origin.y / Chunk::size;
-	glm::ivec2 pos = {origin.x / Chunk::size, origin.z / Chunk::size};
-	float magnitude = radius * radius;
+size_t World::getLoadedChunks() const {
+	return loaded_chunks;
+}
+
+void World::update(WorldGenerator& generator, glm::ivec3 origin, glm::vec3 facing, float radius, int vertical) {
+
+	glm::ivec3 center {origin.x >> Chunk::bits, origin.y >> Chunk::bits, origin.z >> Chunk::bits};
+	glm::ivec2 pos = {center.x, center.z};
+	float limit = std::min(radius, budget_radius);
 
 	double time = Timer::of([&] () {
 
-		std::lock_guard chunks_lock {chunks_mutex};
+		struct Usage {
+			float distance2;
+			size_t bytes;
+			size_t chunks;
+		};
+
+		std::vector<std::shared_ptr<Chunk>> evicted;
+		std::vector<Usage> usages;
+		size_t total = 0;
+		size_t count = 0;
+
+		const auto unload = [&] (ChunkColumn& column) {
+			column.forEach([&] (std::shared_ptr<Chunk>& chunk) {
+				evicted.push_back(std::move(chunk));
+			});
+		};
 
 		// chunk unloading
-		for (auto it = columns.begin(); it != columns.end();) {
-			if (it->second.empty() || glm::distance2(glm::vec2(it->first), glm::vec2(pos)) >= magnitude) {
-				it = columns.erase(it);
-				continue;
+		columns.filter([&] (glm::ivec2 key, ChunkColumn& column) {
+			float distance2 = glm::distance2(glm::vec2(key), glm::vec2(pos));
+
+			if (column.empty() || distance2 >= limit * limit) {
+				unload(column);
+				return false;
 			}
 
-			it->second.update(vertical, py);
-			std::advance(it, 1);
-		}
+			column.update(vertical, center.y, evicted);
+
+			Usage& usage = usages.emplace_back(distance2, column.memory(), column.size());
+			total += usage.bytes;
+			count += usage.chunks;
+			return true;
+		});
+
+		// over the budget, unload the farthest columns and stop loading at that distance until there is room again
+		if (total > budget) {
+			std::sort(usages.begin(), usages.end(), [] (const Usage& a, const Usage& b) {
+				return a.distance2 > b.distance2;
+			});
 
-		// TODO
-		static TaskPool pool {8};
-		static std::vector<glm::ivec3> requested;
-		static std::mutex request_mutex;
+			float cutoff = 0;
 
-		int rings = (int) radius;
-		int ring = 0;
+			for (size_t i = 0; i < usages.size() && total > budget;) {
+				cutoff = usages[i].distance2;
 
-		while (ring < rings) {
-			std::lock_guard request_lock {request_mutex};
+				// columns at the same distance all go together, as the limit can't tell them apart
+				for (; i < usages.size() && usages[i].distance2 == cutoff; i ++) {
+					total -= usages[i].bytes;
+					count -= usages[i].chunks;
+				}
+			}
 
-			planeRingIterator(ring, [&] (int cx, int cz) {
-				for (int cy = -vertical; cy <= vertical; cy++) {
+			columns.filter([&] (glm::ivec2 key, ChunkColumn& column) {
+				if (glm::distance2(glm::vec2(key), glm::vec2(pos)) >= cutoff) {
+					unload(column);
+					return false;
+				}
 
-					// glm::ivec2 uses .y but we store .z in it
-					glm::ivec3 key = {pos.x + cx, py + cy, pos.y + cz};
+				return true;
+			});
 
-					if (glm::length2(glm::vec3(cx, cy, cz)) < magnitude) {
-						auto it = columns.find(glm::ivec2 {key.x, key.z});
+			budget_radius = limit = std::sqrt(cutoff);
+			logger::info("Memory budget of ", budget / 1024 / 1024, " MiB exceeded, view distance limited to ", limit, " chunks");
 
-						if (it == columns.end() || (!it->second.contains(key.y))) {
-							if (requested.size() > 8) {
-								return;
-							}
+		} else if (budget_radius < radius && scheduler.pending() == 0 && scheduler.active() == 0) {
 
-							if (std::find(requested.begin(), requested.end(), key) != requested.end()) {
-								continue;
-							}
+			// the columns one chunk further out, estimated from the loaded ones, as
+			// growing into a ring that doesn't fit would just unload it again
+			const float ring = (float) M_PI * ((limit + 1) * (limit + 1) - limit * limit);
+			const size_t estimate = usages.empty() ? 0 : (size_t) (ring * total / usages.size());
 
-							requested.push_back(key);
+			// there is room again and everything in range is loaded, grow back one chunk at a time
+			if (total + estimate < budget * 0.9) {
+				budget_radius += 1;
+			}
+		}
 
-							pool.enqueue([this, &generator, key]() {
-								Chunk* chunk = generator.get(key);
+		if (budget_radius >= radius) {
+			budget_radius = INFINITY;
+		}
 
-								{
-									std::lock_guard lock {chunks_mutex};
-									columns[glm::ivec2 {key.x, key.z}].emplace(chunk);
-								}
+		memory_usage = total;
+		loaded_chunks = count;
 
-								pushChunkUpdate(key, ChunkUpdate::INITIAL_LOAD);
+		// write back unloaded chunks, this doesn't wait for the writes to complete,
+		// the cached copy will then match what is (or soon will be) stored
+		for (std::shared_ptr<Chunk>& chunk : evicted) {
+			if (store && chunk->isModified()) {
+				store->save(chunk);
+			}
 
-								{
-									std::lock_guard lock {request_mutex};
-									util::fastVectorErase(requested, std::find(requested.begin(), requested.end(), key));
-								}
-							});
+			cache.put(std::move(chunk));
+		}
 
-							continue;
-						}
-					}
-				}
-			});
+		// forget the outdated chunks that can no longer come back restored, the scheduler is checked first as a
+		// running load takes the chunk out of the cache before adding it, and new loads only start below
+		{
+			std::lock_guard lock {updates_mutex};
 
-			ring++;
+			std::erase_if(outdated, [&] (glm::ivec3 key) {
+				return !scheduler.scheduled(key) && getChunk(key.x, key.y, key.z).expired() && !cache.contains(key);
+			});
 		}
 
+		// chunk loading
+		scheduler.update(center, facing, limit, vertical, [this] (glm::ivec3 key) {
+			return columns.contains(key);
+		}, [this, &generator] (glm::ivec3 key) {
+			if (Chunk* chunk = cache.take(key)) {
+				emplace(chunk, ChunkUpdate::INITIAL_LOAD | ChunkUpdate::RESTORED);
+				return;
+			}
+
+			Chunk* chunk = store ? store->load(key) : nullptr;
+
+			// a failed generation leaves the chunk unloaded, the scheduler will request it again
+			if (!chunk) {
+				try {
+					chunk = generator.get(key);
+				} catch (Exception& exception) {
+					logger::error("Failed to generate chunk ", key.x, " ", key.y, " ", key.z, ", ", exception.getMessage());
+					return;
+				} catch (std::exception& exception) {
+					logger::error("Failed to generate chunk ", key.x, " ", key.y, " ", key.z, ", ", exception.what());
+					return;
+				} catch (...) {
+					logger::error("Failed to generate chunk ", key.x, " ", key.y, " ", key.z, ", unknown error");
+					return;
+				}
+			}
+
+			emplace(chunk);
+		});
+
 	}).milliseconds();
 
 	times.insert(time);
@@ -110,26 +253,34 @@ void World::update(WorldGenerator& generator, glm::ivec3 origin, float radius, f
 	if (times.full()) {
 		float avg = std::reduce(times.begin(), times.end()) / times.size();
 
-		logger::info("Avg update time: ", avg, "ms");
+		logger::info("Avg update time: ", avg, "ms, pending loads: ", scheduler.pending(), ", active loads: ", scheduler.active());
+		logger::info("Chunk cache: ", cache.size(), " chunks, ", cache.bytes() / 1024, " KiB, ", cache.hits(), " hits, ", cache.misses(), " misses");
+		logger::info("Loaded chunks: ", loaded_chunks.load(), ", ", memory_usage / 1024, " KiB, budget: ", budget / 1024, " KiB");
 		times.clear(0);
 	}
 
 }
 
-std::weak_ptr<Chunk> World::getUnsafeChunk(int cx, int cy, int cz) {
-	const glm::ivec2 key {cx, cz};
-	auto it = columns.find(key);
-
-	if (it == columns.end()) {
-		return {};
+void World::save() {
+	if (!store) {
+		return;
 	}
 
-	return it->second.get(cy);
+	columns.filter([&] (glm::ivec2 key, ChunkColumn& column) {
+		column.forEach([&] (std::shared_ptr<Chunk>& chunk) {
+			if (chunk->isModified()) {
+				store->save(chunk);
+			}
+		});
+
+		return true;
+	});
+
+	store->flush();
 }
 
 std::weak_ptr<Chunk> World::getChunk(int cx, int cy, int cz) {
-	std::lock_guard lock {chunks_mutex};
-	return getUnsafeChunk(cx, cy, cz);
+	return columns.get({cx, cy, cz});
 }
 
 Block World::getBlock(int x, int y, int z) {
@@ -144,6 +295,16 @@ Block World::getBlock(int x, int y, int z) {
 	throw AccessError {x, y, z};
 }
 
+std::optional<int> World::getHeight(int x, int z) {
+	int height = columns.getHeight(x, z);
+
+	if (height == ChunkColumn::no_height) {
+		return std::nullopt;
+	}
+
+	return height;
+}
+
 void World::setBlock(int x, int y, int z, Block block) {
 	int cx = x >> Chunk::bits;
 	int cy = y >> Chunk::bits;
@@ -154,67 +315,308 @@ void World::setBlock(int x, int y, int z, Block block) {
 		int my = y & Chunk::mask;
 		int mz = z & Chunk::mask;
 
-		// setting non-air blocks doesn't require updating neighbours (for now)
-		pushChunkUpdate({cx, cy, cz}, ChunkUpdate::IMPORTANT | (block.isAir() ? Chunk::getNeighboursMask(mx, my, mz).mask : Direction::NONE));
+		// the heightmap update needs to see the new block
+		chunk->setBlock(mx, my, mz, block);
+		pushBlockUpdate({cx, cy, cz}, mx, my, mz, block);
 
-		return chunk->setBlock(mx, my, mz, block);
+		return;
 	}
 
 	throw AccessError {x, y, z};
 }
 
+void World::apply(std::span<const BlockEdit> edits) {
+	ankerl::unordered_dense::map<glm::ivec3, std::vector<BlockEdit>> groups;
+
+	for (const BlockEdit& edit : edits) {
+		glm::ivec3 key {edit.pos.x >> Chunk::bits, edit.pos.y >> Chunk::bits, edit.pos.z >> Chunk::bits};
+		groups[key].push_back(edit);
+	}
+
+	// resolve all chunks before writing anything, so that
+	// an unloaded chunk doesn't leave the edit half-applied
+	std::vector<std::pair<std::shared_ptr<Chunk>, const std::vector<BlockEdit>*>> chunks;
+	chunks.reserve(groups.size());
+
+	for (auto& [key, group] : groups) {
+		std::shared_ptr<Chunk> chunk = getChunk(key.x, key.y, key.z).lock();
+
+		if (!chunk) {
+			glm::ivec3 pos = group.front().pos;
+			throw AccessError {pos.x, pos.y, pos.z};
+		}
+
+		chunks.emplace_back(std::move(chunk), &group);
+	}
+
+	std::vector<std::pair<glm::ivec3, uint8_t>> flags;
+	flags.reserve(chunks.size());
+
+	for (auto& [chunk, group] : chunks) {
+		uint8_t flag = ChunkUpdate::IMPORTANT;
+
+		for (const BlockEdit& edit : *group) {
+			int mx = edit.pos.x & Chunk::mask;
+			int my = edit.pos.y & Chunk::mask;
+			int mz = edit.pos.z & Chunk::mask;
+
+			// setting non-air blocks doesn't require updating neighbours (for now)
+			if (edit.block.isAir()) {
+				flag |= Chunk::getNeighboursMask(mx, my, mz).mask;
+			}
+
+			chunk->setBlock(mx, my, mz, edit.block);
+		}
+
+		flags.emplace_back(chunk->pos, flag);
+	}
+
+	// edits to the same position stay in order, and everything is already written
+	// when a removed top block makes the heightmap look for the next one below
+	for (auto& [chunk, group] : chunks) {
+		for (const BlockEdit& edit : *group) {
+			columns.updateHeight(edit.pos.x, edit.pos.z, edit.pos.y, edit.pos.y, edit.block.isAir());
+			fluids.activate(edit.pos);
+			ticker.notify(edit.pos, edit.block);
+		}
+	}
+
+	pushChunkUpdates(flags);
+}
+
+void World::fill(glm::ivec3 from, glm::ivec3 to, Block block) {
+	glm::ivec3 low = glm::min(from, to);
+	glm::ivec3 high = glm::max(from, to);
+
+	std::vector<std::shared_ptr<Chunk>> chunks;
+
+	for (int cz = low.z >> Chunk::bits; cz <= (high.z >> Chunk::bits); cz ++) {
+		for (int cy = low.y >> Chunk::bits; cy <= (high.y >> Chunk::bits); cy ++) {
+			for (int cx = low.x >> Chunk::bits; cx <= (high.x >> Chunk::bits); cx ++) {
+				std::shared_ptr<Chunk> chunk = getChunk(cx, cy, cz).lock();
+
+				if (!chunk) {
+					throw AccessError {cx * Chunk::size, cy * Chunk::size, cz * Chunk::size};
+				}
+
+				chunks.push_back(std::move(chunk));
+			}
+		}
+	}
+
+	std::vector<std::pair<glm::ivec3, uint8_t>> flags;
+	flags.reserve(chunks.size());
+
+	for (auto& chunk : chunks) {
+		glm::ivec3 origin = chunk->pos * Chunk::size;
+		glm::ivec3 start = glm::max(low, origin) - origin;
+		glm::ivec3 end = glm::min(high, origin + Chunk::mask) - origin;
+
+		if (start == glm::ivec3 {0} && end == glm::ivec3 {Chunk::mask}) {
+			chunk->fill(block);
+		} else {
+			chunk->fill(start, end, block);
+		}
+
+		// setting non-air blocks doesn't require updating neighbours (for now)
+		Direction::mask_type neighbours = Chunk::getNeighboursMask(start.x, start.y, start.z) | Chunk::getNeighboursMask(end.x, end.y, end.z);
+		flags.emplace_back(chunk->pos, ChunkUpdate::IMPORTANT | (block.isAir() ? neighbours : Direction::NONE));
+		ticker.notify(origin, block);
+	}
+
+	for (int z = low.z; z <= high.z; z ++) {
+		for (int x = low.x; x <= high.x; x ++) {
+			columns.updateHeight(x, z, low.y, high.y, block.isAir());
+		}
+	}
+
+	// the cells inside have only the same block around them, so they can only change after a cell
+	// on the surface does, it's enough to activate the surface and let the changes spread inward
+	for (int z = low.z; z <= high.z; z ++) {
+		for (int y = low.y; y <= high.y; y ++) {
+			const bool edge = z == low.z || z == high.z || y == low.y || y == high.y;
+			const int step = edge ? 1 : std::max(high.x - low.x, 1);
+
+			for (int x = low.x; x <= high.x; x += step) {
+				fluids.activate({x, y, z});
+			}
+		}
+	}
+
+	pushChunkUpdates(flags);
+}
+
+void World::tick(TaskPool& pool) {
+	std::vector<BlockEdit> edits;
+	ticker.tick(*this, pool, edits);
+
+	if (!edits.empty()) {
+		apply(edits);
+	}
+
+	tickFluids(pool);
+}
+
+void World::advance(TaskPool& pool) {
+	using Clock = std::chrono::steady_clock;
+
+	const Clock::time_point now = Clock::now();
+	const Clock::duration period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double> {1.0 / tick_rate});
+
+	if (next_tick == Clock::time_point {}) {
+		next_tick = now;
+	}
+
+	for (int i = 0; i < tick_catchup && next_tick <= now; i ++) {
+		tick(pool);
+		next_tick += period;
+	}
+
+	// we are too far behind, skip the rest instead of trying to catch up forever
+	if (next_tick <= now) {
+		next_tick = now + period;
+	}
+}
+
+size_t World::tickFluids(TaskPool& pool) {
+	std::vector<BlockEdit> changes;
+	fluids.tick(*this, pool, changes);
+
+	std::vector<std::pair<glm::ivec3, uint8_t>> flags;
+
+	for (const BlockEdit& change : changes) {
+		glm::ivec3 chunk {change.pos.x >> Chunk::bits, change.pos.y >> Chunk::bits, change.pos.z >> Chunk::bits};
+
+		// the changes are grouped by chunk
+		if (flags.empty() || flags.back().first != chunk) {
+			flags.emplace_back(chunk, ChunkUpdate::UNIMPORTANT);
+		}
+
+		// setting non-air blocks doesn't require updating neighbours (for now)
+		if (change.block.isAir()) {
+			flags.back().second |= Chunk::getNeighboursMask(change.pos.x & Chunk::mask, change.pos.y & Chunk::mask, change.pos.z & Chunk::mask).mask;
+		}
+
+		columns.updateHeight(change.pos.x, change.pos.z, change.pos.y, change.pos.y, change.block.isAir());
+	}
+
+	pushChunkUpdates(flags);
+	return changes.size();
+}
+
 Raycast World::raycast(glm::vec3 from, glm::vec3 direction, float distance) {
 
-	const float magnitude = distance * distance;
-	glm::vec3 diff = direction * distance;
-	glm::ivec3 sign = glm::sign(diff);
-	glm::ivec3 pos = glm::round(from);
-	glm::vec3 inv = glm::abs(1.0f / diff);
+	// size of the sub-chunk bricks tested with the occupancy mask before stepping block by block
+	constexpr int brick = 4;
+
+	// in this space block N spans [N, N+1) instead of [N-0.5, N+0.5)
+	const glm::vec3 origin = from + 0.5f;
+	const glm::vec3 normal = glm::normalize(direction);
+	const glm::ivec3 step = glm::sign(normal);
+	const glm::vec3 delta = glm::abs(1.0f / normal);
+
+	glm::ivec3 pos = glm::floor(origin);
+	glm::ivec3 last = pos;
+	glm::ivec3 checked {INT_MAX};
 
-	glm::vec3 max {
-		inv.x * (sign.x > 0 ? (pos.x + (0.5f - from.x)) : (from.x - (pos.x - 0.5f))),
-		inv.y * (sign.y > 0 ? (pos.y + (0.5f - from.y)) : (from.y - (pos.y - 0.5f))),
-		inv.z * (sign.z > 0 ? (pos.z + (0.5f - from.z)) : (from.z - (pos.z - 0.5f)))
+	// the distance at which the ray crosses the next cell boundary along each axis
+	const auto boundary = [&] (int axis, int cell) -> float {
+		if (step[axis] == 0) return INFINITY;
+		return ((step[axis] > 0 ? cell + 1 : cell) - origin[axis]) / normal[axis];
 	};
 
-	try {
-		Block block = getBlock(pos.x, pos.y, pos.z);
+	glm::vec3 max {boundary(0, pos.x), boundary(1, pos.y), boundary(2, pos.z)};
+	float travelled = 0;
 
-		if (!block.isAir()) {
-			return {pos, pos};
+	// most steps stay within the same chunk, the accessor caches it for us
+	BlockAccessor accessor {*this};
+
+	while (travelled <= distance) {
+		Chunk* chunk = accessor.getChunk(pos.x >> Chunk::bits, pos.y >> Chunk::bits, pos.z >> Chunk::bits);
+
+		if (!chunk) {
+			return {Raycast::UNLOADED, pos, last};
 		}
 
-		while (glm::length2(from - glm::vec3(pos)) <= magnitude) {
-			glm::ivec3 last = pos;
+		glm::ivec3 local {pos.x & Chunk::mask, pos.y & Chunk::mask, pos.z & Chunk::mask};
+		int skip = 1;
 
-			if (max.x < max.y) {
-				if (max.x < max.z) {
-					pos.x += sign.x;
-					max.x += inv.x;
-				} else {
-					pos.z += sign.z;
-					max.z += inv.z;
-				}
-			} else {
-				if (max.y < max.z) {
-					pos.y += sign.y;
-					max.y += inv.y;
+		if (chunk->empty()) {
+			skip = Chunk::size;
+		} else {
+			glm::ivec3 corner {local.x & ~(brick - 1), local.y & ~(brick - 1), local.z & ~(brick - 1)};
+
+			// only test the brick when we enter it, not on every step within it
+			if (corner + (pos - local) != checked) {
+				if (chunk->empty(corner, corner + (brick - 1))) {
+					skip = brick;
 				} else {
-					pos.z += sign.z;
-					max.z += inv.z;
+					checked = corner + (pos - local);
 				}
 			}
+		}
 
-			block = getBlock(pos.x, pos.y, pos.z);
-			if (!block.isAir()) {
+		if (skip == 1) {
+			if (chunk->occupied(local.x, local.y, local.z)) {
 				return {pos, last};
 			}
+
+			last = pos;
+			int axis = (max.x < max.y) ? (max.x < max.z ? 0 : 2) : (max.y < max.z ? 1 : 2);
+
+			travelled = max[axis];
+			pos[axis] += step[axis];
+			max[axis] += delta[axis];
+			continue;
 		}
 
-		// If we reach here, we've traveled the full distance without hitting anything
-		return {};
+		// jump straight to the first block after the empty cell, the axis with
+		// the closest boundary is the one on which we leave the cell
+		glm::ivec3 low {pos.x & ~(skip - 1), pos.y & ~(skip - 1), pos.z & ~(skip - 1)};
+		glm::vec3 exit {boundary(0, low.x + (step.x > 0 ? skip - 1 : 0)), boundary(1, low.y + (step.y > 0 ? skip - 1 : 0)), boundary(2, low.z + (step.z > 0 ? skip - 1 : 0))};
+		int axis = (exit.x < exit.y) ? (exit.x < exit.z ? 0 : 2) : (exit.y < exit.z ? 1 : 2);
+
+		travelled = exit[axis];
+		glm::vec3 point = origin + normal * travelled;
+
+		for (int i = 0; i < 3; i ++) {
+			pos[i] = std::clamp((int) std::floor(point[i]), low[i], low[i] + skip - 1);
+		}
 
-	} catch (AccessError& error) {
-		return {};
+		pos[axis] = step[axis] > 0 ? low[axis] + skip : low[axis] - 1;
+		last = pos;
+		last[axis] -= step[axis];
+
+		max = {boundary(0, pos.x), boundary(1, pos.y), boundary(2, pos.z)};
 	}
-}
\ No newline at end of file
+
+	// If we reach here, we've traveled the full distance without hitting anything
+	return {};
+}
+
+std::vector<Raycast> World::raycastMany(TaskPool& pool, std::span<const Ray> rays) {
+
+	// large enough for the task overhead to not matter
+	constexpr size_t batch = 64;
+
+	std::vector<Raycast> results(rays.size());
+	std::vector<std::future<bool>> futures;
+
+	for (size_t start = 0; start < rays.size(); start += batch) {
+		futures.push_back(pool.defer([this, &rays, &results, start] () {
+			size_t end = std::min(start + batch, rays.size());
+
+			for (size_t i = start; i < end; i ++) {
+				results[i] = raycast(rays[i].from, rays[i].direction, rays[i].distance);
+			}
+
+			return true;
+		}));
+	}
+
+	for (auto& future : futures) {
+		future.get();
+	}
+
+	return results;
+}
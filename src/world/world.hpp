@@ -8,6 +8,13 @@
 #include "util/collection/ring.hpp"
 #include "view.hpp"
 #include "column.hpp"
+#include "map.hpp"
+#include "accessor.hpp"
+#include "storage/region.hpp"
+#include "storage/cache.hpp"
+#include "scheduler.hpp"
+#include "fluid.hpp"
+#include "ticker.hpp"
 
 struct AccessError : std::exception {
 
@@ -21,7 +28,7 @@ struct AccessError : std::exception {
 };
 
 class WorldGenerator;
-class Raycast;
+class TaskPool;
 
 class World {
 
@@ -32,38 +39,57 @@ class World {
 			static constexpr uint8_t UNIMPORTANT  = 0b00'000000;
 			static constexpr uint8_t IMPORTANT    = 0b10'000000;
 
+			/// the chunk was restored unchanged from the chunk cache and no neighbour changed meanwhile, its old mesh can still be used
+			static constexpr uint8_t RESTORED     = 0b01'000000;
+
 			/// the flag set used for newly loaded chunks
 			static constexpr uint8_t INITIAL_LOAD = UNIMPORTANT | Direction::ALL;
 
-			static_assert((IMPORTANT & Direction::ALL) == 0, "The ChunkUpdate and Direction flags need to be able to be combined");
+			static_assert(((IMPORTANT | RESTORED) & Direction::ALL) == 0, "The ChunkUpdate and Direction flags need to be able to be combined");
 			static_assert(sizeof(uint8_t) >= sizeof(Direction::mask_type), "The ChunkUpdate and Direction flags need to be able to be combined");
 
-			struct Hasher {
-				std::size_t operator()(const ChunkUpdate& update) const {
-					return std::hash<glm::ivec3>()(update.pos);
-				}
-			};
-
-			glm::ivec3 pos;
-			bool important;
-
-			bool operator ==(ChunkUpdate other) const {
-				return pos == other.pos;
+			/// Combines two flag sets, the result is only restored if both of them were
+			static uint8_t merge(uint8_t first, uint8_t second) {
+				return ((first | second) & ~RESTORED) | (first & second & RESTORED);
 			}
 
-			ChunkUpdate(glm::ivec3 pos, bool important)
-			: pos(pos), important(important) {}
-
 		};
 
 		RingBuffer<double, 256> times;
 
-		std::mutex chunks_mutex;
-		ankerl::unordered_dense::map<glm::ivec2, ChunkColumn> columns;
+		ColumnMap columns;
+
+		// recently unloaded chunks, checked before the store and generator
+		ChunkCache cache {64 * 1024 * 1024};
+
+		// null if this world is not persistent
+		std::unique_ptr<RegionStore> store;
+
+		// the load tasks use the cache, the store and (through emplace) the members declared below,
+		// the destructor cancels the queued loads and waits for the running ones before any of them is destroyed
+		LoadScheduler scheduler {8, 16};
+
+		// the memory budget of the loaded chunks, while it's exceeded the view distance is limited to `budget_radius`
+		size_t budget = 1024 * 1024 * 1024;
+		float budget_radius = INFINITY;
+
+		// as counted by the last update
+		std::atomic<size_t> memory_usage {0};
+		std::atomic<size_t> loaded_chunks {0};
+
+		FluidSimulator fluids;
+		BlockTicker ticker;
+
+		// when the next fixed rate tick is due, unset before the first tick
+		std::chrono::steady_clock::time_point next_tick {};
 
 		std::mutex updates_mutex;
 		ankerl::unordered_dense::map<glm::ivec3, uint8_t> updates;
 
+		// chunks whose update was dropped as they (or a neighbour) were not loaded, their old
+		// meshes are outdated, so the next update can't be restored even if the chunk itself didn't change
+		ankerl::unordered_dense::set<glm::ivec3> outdated;
+
 		/// Simple utility to iterate a plane with ever expanding concentric square rings
 		template <typename Func>
 		void planeRingIterator(int ring, Func func) {
@@ -91,42 +117,81 @@ class World {
 			}
 		}
 
+		/// Adds a chunk to the world and pushes the given update for it
+		void emplace(Chunk* chunk, uint8_t flags);
+
 	public:
 
+		/// the rate of the fixed world tick, in ticks per second
+		static constexpr int tick_rate = 20;
+
+		/// the most ticks run at once to catch up, any time missed beyond that is skipped
+		static constexpr int tick_catchup = 5;
+
+		/// Creates a new world that is not stored anywhere
+		World() = default;
+
+		/// Creates a new world that is stored in the given directory, the
+		/// stored chunks are used in place of the generated ones
+		World(const std::filesystem::path& directory);
+		~World();
+
 		/// Used by the WorldRenderer, iterates and clears the chunk update set
 		template <typename Func>
 		void consumeUpdates(Func func) {
-			std::unordered_set<ChunkUpdate, ChunkUpdate::Hasher> set;
+			ankerl::unordered_dense::map<glm::ivec3, uint8_t> set;
 			set.reserve(updates.size() * 2);
 
+			const auto merge = [&] (glm::ivec3 pos, uint8_t flags) {
+				auto [it, inserted] = set.try_emplace(pos, flags);
+
+				if (!inserted) {
+					it->second = ChunkUpdate::merge(it->second, flags);
+				}
+			};
+
 			{
 				std::lock_guard lock {updates_mutex};
 
 				// propagate updates
 				for (auto& [pos, flags] : updates) {
 					for (Direction direction : Direction::decompose(flags & Direction::ALL)) {
-						set.emplace(Direction::offset(direction) + pos, flags & ChunkUpdate::IMPORTANT);
+						merge(Direction::offset(direction) + pos, flags & ~Direction::ALL);
 					}
 
-					set.emplace(pos, flags & ChunkUpdate::IMPORTANT);
+					merge(pos, flags & ~Direction::ALL);
 				}
 
 				updates.clear();
+
+				for (auto& [pos, flags] : set) {
+					if (outdated.erase(pos)) {
+						flags &= ~ChunkUpdate::RESTORED;
+					}
+				}
 			}
 
 			if (!set.empty()) {
 				logger::debug("Requesting remeshing of ", set.size(), " chunks");
 			}
 
-			// call once for each updated chunk
-			std::lock_guard lock {chunks_mutex};
+			std::vector<glm::ivec3> dropped;
 
-			for (auto update : set) {
-				WorldView view = getUnsafeView(update.pos, Direction::ALL);
+			// call once for each updated chunk
+			for (auto [pos, flags] : set) {
+				WorldView view = getView(pos, Direction::ALL);
 
-				if (!view.failed()) {
-					func(std::move(view), update.important);
+				if (view.failed()) {
+					dropped.push_back(pos);
+					continue;
 				}
+
+				func(std::move(view), flags & ChunkUpdate::IMPORTANT, flags & ChunkUpdate::RESTORED);
+			}
+
+			if (!dropped.empty()) {
+				std::lock_guard lock {updates_mutex};
+				outdated.insert(dropped.begin(), dropped.end());
 			}
 		}
 
@@ -134,16 +199,52 @@ class World {
 		/// and which neighbours are also affected and also needs to be remeshed
 		void pushChunkUpdate(glm::ivec3 chunk, uint8_t flags);
 
+		/// Same as pushChunkUpdate but for many chunks at once, takes the lock only once
+		void pushChunkUpdates(const std::vector<std::pair<glm::ivec3, uint8_t>>& flags);
+
+		/// Notifies the world that a single block (given in chunk-local coordinates) in the `chunk` changed,
+		/// this also updates the heightmap so needs to be called after the block is written
+		void pushBlockUpdate(glm::ivec3 chunk, int x, int y, int z, Block block);
+
+		/// Adds a chunk to the world, the world takes ownership of the chunk
+		/// and it will be meshed like any other newly loaded chunk
+		void emplace(Chunk* chunk);
+
+		/// Returns the cache of recently unloaded chunks
+		ChunkCache& getCache();
+
+		/// Returns the scheduler used to load chunks, can be used to configure the in-flight limit
+		LoadScheduler& getScheduler();
+
+		/// Returns the fluid simulator, can be used to activate cells changed outside of the World methods
+		FluidSimulator& getFluids();
+
+		/// Returns the block ticker, used to register the block tick handlers and schedule ticks
+		BlockTicker& getTicker();
+
+		/// Sets the number of bytes the loaded chunks can use, when exceeded the farthest columns
+		/// are unloaded first and the view distance is reduced until there is room again
+		void setMemoryBudget(size_t bytes);
+
+		/// Returns the memory budget of the loaded chunks, in bytes
+		size_t getMemoryBudget() const;
+
+		/// Returns the number of bytes used by the loaded chunks and columns, as counted by the last update
+		size_t getMemoryUsage() const;
+
+		/// Returns the number of loaded chunks, as counted by the last update
+		size_t getLoadedChunks() const;
+
 		/// Update the world
-		/// manages chunk loading and unloading
-		void update(WorldGenerator& generator, glm::ivec3 origin, float radius, float vertical);
+		/// manages chunk loading and unloading, chunks in the `facing` direction are loaded first,
+		/// columns beyond the radius or the memory budget are unloaded, farthest first
+		void update(WorldGenerator& generator, glm::ivec3 origin, glm::vec3 facing, float radius, int vertical);
 
-		/// Creates a new WorldView around the specified chunk
-		/// this functions is unsafe - expects the caller to lock chunks_mutex
-		WorldView getUnsafeView(glm::ivec3 chunk, Direction directions);
+		/// Writes all modified chunks to disk, blocks until all (including previously scheduled) writes complete
+		void save();
 
-		/// Creates a new WorldView, right now this expects external the chunks_mutex to be locked by the caller
-		std::weak_ptr<Chunk> getUnsafeChunk(int cx, int cy, int cz);
+		/// Creates a new WorldView around the specified chunk
+		WorldView getView(glm::ivec3 chunk, Direction directions);
 
 		/// Returns the chunk at the specified chunk coordinates
 		/// if the chunk is not loaded returns an empty weak_ptr
@@ -153,12 +254,38 @@ class World {
 		/// if the containing chunk is not loaded throws AccessError
 		Block getBlock(int x, int y, int z);
 
+		/// Returns the world Y of the highest non-air block in the loaded chunks at the given
+		/// world X and Z, or nothing if there is no such block, this is a heightmap lookup
+		std::optional<int> getHeight(int x, int z);
+
 		/// returns the block at the specified world coordinates,
 		/// if the containing chunk is not loaded throws AccessError
 		void setBlock(int x, int y, int z, Block block);
 
+		/// Applies all the given edits, the edits are grouped by chunk and each affected chunk receives only one update,
+		/// if any of the containing chunks is not loaded throws AccessError before any edit is applied
+		void apply(std::span<const BlockEdit> edits);
+
+		/// Sets all blocks in the given box (with both corners inclusive) to the given block,
+		/// if any of the containing chunks is not loaded throws AccessError before any edit is applied
+		void fill(glm::ivec3 from, glm::ivec3 to, Block block);
+
+		/// Runs one world tick, the block ticks and then the fluid simulation, both parallelized on the given pool
+		void tick(TaskPool& pool);
+
+		/// Runs as many world ticks as needed to keep up with the fixed tick rate, meant to be called once per frame
+		void advance(TaskPool& pool);
+
+		/// Runs one step of the fluid simulation on the given pool, the changed chunks are all
+		/// updated at once, returns the number of changed blocks (zero if all the fluid is settled)
+		size_t tickFluids(TaskPool& pool);
+
 		/// Casts a ray from the given position until the
-		/// distance limit, a block, or an unloaded chunk is encountered
+		/// distance limit, a block, or an unloaded chunk is encountered,
+		/// empty chunks and empty sub-chunk bricks are skipped in one step
 		Raycast raycast(glm::vec3 from, glm::vec3 direction, float distance);
 
+		/// Casts all the given rays in parallel on the given pool, blocks until all the results are ready
+		std::vector<Raycast> raycastMany(TaskPool& pool, std::span<const Ray> rays);
+
 };